@@ -0,0 +1,402 @@
+// microbenchmarks of the kernels and checkers. every case is run after
+// warmup repetitions on the steady clock, and its repetition times are
+// printed as one json line with their median and percentiles, so that runs
+// of different commits and cpus can be compared line by line.
+
+#include <gmp.h>
+#include <gmpxx.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "chain_stats.h"
+#include "collatz_checker_dc.h"
+#include "collatz_checker_fast.h"
+#include "collatz_checker_naive.h"
+#include "collatz_checker_slow.h"
+#include "collatz_multistep.h"
+#include "elapsed_time.h"
+#include "parallel_mul.h"
+#include "power_of_3_big.h"
+
+using std::cout;
+using std::string;
+using std::vector;
+namespace ela = elapsed_time;
+
+struct bench_options {
+	// only cases whose name contains filter are run
+	string filter;
+
+	size_t warmup_count = 1;
+	size_t rep_count = 7;
+
+	// no more repetitions are started once a case has taken this long
+	double max_case_s = 10;
+
+	// the checker sweep goes up to this bit length
+	size_t max_bits = 1000000;
+};
+
+class bench_runner {
+public:
+	explicit bench_runner(const bench_options &opts) :
+			opts(opts) {
+	}
+
+	// rep() does op_count operations and returns the nanoseconds they took, so
+	// that it can keep its setup out of the measurement
+	void run(const string &name, const string &param, size_t op_count,
+			const std::function<ela::elapsed_time_ns()> &rep) {
+		if (name.find(opts.filter) == string::npos) {
+			return;
+		}
+
+		for (size_t i = 0; i < opts.warmup_count; i++) {
+			rep();
+		}
+
+		vector<ela::elapsed_time_ns> times;
+		ela::elapsed_time_ns total = 0;
+
+		while (times.size() < opts.rep_count && (times.empty() || total < opts.max_case_s * ela::NS_PER_SEC)) {
+			times.push_back(rep());
+			total += times.back();
+		}
+
+		std::sort(times.begin(), times.end());
+
+		cout << "{\"bench\":\"" << name << "\"" //
+				<< ",\"param\":\"" << param << "\"" //
+				<< ",\"reps\":" << times.size() //
+				<< ",\"ops\":" << op_count //
+				<< ",\"median_ns\":" << percentile(times, 50) //
+				<< ",\"p10_ns\":" << percentile(times, 10) //
+				<< ",\"p90_ns\":" << percentile(times, 90) //
+				<< ",\"min_ns\":" << times.front() //
+				<< ",\"max_ns\":" << times.back() //
+				<< ",\"median_ns_per_op\":" << (double) percentile(times, 50) / op_count //
+				<< "}\n" << std::flush;
+	}
+
+	const bench_options &opts;
+
+private:
+	// nearest rank of a sorted list
+	static ela::elapsed_time_ns percentile(const vector<ela::elapsed_time_ns> &sorted, size_t p) {
+		size_t rank = (p * sorted.size() + 99) / 100;
+		return sorted[std::max(rank, (size_t) 1) - 1];
+	}
+};
+
+static volatile mp_limb_t sink;
+
+// STEP_COUNT steps on each of LIMB_COUNT limbs, by table rounds and single
+// steps
+template<size_t STEP_COUNT>
+static void bench_impact(bench_runner &runner) {
+	const size_t LIMB_COUNT = 1 << 16;
+	vector<mp_limb_t> limbs = random_limbs(LIMB_COUNT, 1);
+
+	string steps = "steps=" + std::to_string(STEP_COUNT);
+
+	for (size_t width : collatz_multistep::IMPACT_WIDTH_LIST) {
+		collatz_multistep::with_impact_width(width, [&](auto w) {
+			runner.run("impact/combined_exactly", steps + " width=" + std::to_string(width), LIMB_COUNT, [&] {
+				size_t step_count_evn = 0;
+				size_t step_count_odd = 0;
+				mp_limb_t acc = 0;
+
+				ela::elapsed_time_ns t = ela::steady_time();
+
+				for (mp_limb_t limb : limbs) {
+					dbl_limb_t value = limb;
+					collatz_multistep::combined_impact_exactly<dbl_limb_t, STEP_COUNT, decltype(w)::value>(value,
+							step_count_evn, step_count_odd);
+					acc ^= (mp_limb_t) value;
+				}
+
+				t = ela::steady_time() - t;
+
+				sink = acc + step_count_odd;
+				return t;
+			});
+		});
+	}
+
+	runner.run("impact/simple_exactly", steps, LIMB_COUNT, [&] {
+		size_t step_count_evn = 0;
+		size_t step_count_odd = 0;
+		mp_limb_t acc = 0;
+
+		ela::elapsed_time_ns t = ela::steady_time();
+
+		for (mp_limb_t limb : limbs) {
+			dbl_limb_t value = limb;
+			collatz_multistep::simple_exactly<dbl_limb_t, STEP_COUNT>(value, step_count_evn, step_count_odd);
+			acc ^= (mp_limb_t) value;
+		}
+
+		t = ela::steady_time() - t;
+
+		sink = acc + step_count_odd;
+		return t;
+	});
+}
+
+static const size_t ACCUMULATOR_LIMB_COUNTS[] = { 16, 256, 4096, 65536 };
+
+// the pushes a level 0 accumulator of the given size gets from iterate(),
+// and pulls of limb_count limbs into a child with a matching exp_of_3
+static void bench_accumulator(bench_runner &runner) {
+	no_chain_stats stats;
+
+	for (size_t limb_count : ACCUMULATOR_LIMB_COUNTS) {
+		string param = "limbs=" + std::to_string(limb_count);
+
+		mpz_class value = random_value(limb_count * LIMB_BITSIZE, 2);
+		vector<mp_limb_t> pushed = random_limbs(256, 3);
+
+		runner.run("accumulator/push_back", param, pushed.size(), [&] {
+			accumulator acc;
+			acc.buf.assign(value.get_mpz_t());
+			acc.adjust_available_to_value();
+
+			ela::elapsed_time_ns t = ela::steady_time();
+
+			for (mp_limb_t p : pushed) {
+				acc.push_back((dbl_limb_t) (p >> 1), 20 + (p & 15), 0, stats, 0);
+			}
+
+			return ela::steady_time() - t;
+		});
+
+		mpz_class parent_value = random_value(2 * limb_count * LIMB_BITSIZE, 4);
+
+		runner.run("accumulator/pull_from_parent", param, 1, [&] {
+			accumulator parent;
+			parent.buf.assign(parent_value.get_mpz_t());
+			parent.adjust_available_to_value();
+
+			// about as many odd steps as a child of this size collects
+			accumulator child;
+			child.exp_of_3 = limb_count * LIMB_BITSIZE * 3 / 10;
+
+			ela::elapsed_time_ns t = ela::steady_time();
+
+			child.pull_from_parent(parent, limb_count, stats, 0);
+
+			return ela::steady_time() - t;
+		});
+	}
+}
+
+static const size_t POW3_EXPONENTS[] = { 1000, 10000, 100000, 1000000 };
+
+// powers of 3 from a fresh cache, from a warm cache and computed directly
+static void bench_pow3(bench_runner &runner) {
+	for (size_t exponent : POW3_EXPONENTS) {
+		string param = "exponent=" + std::to_string(exponent);
+
+		runner.run("pow3/calculate", param, 1, [&] {
+			ela::elapsed_time_ns t = ela::steady_time();
+			mpz_class p = power_of_3_big::calculate(exponent);
+			t = ela::steady_time() - t;
+
+			sink = mpz_getlimbn(p.get_mpz_t(), 0);
+			return t;
+		});
+
+		runner.run("pow3/lookup_cold", param, 1, [&] {
+			power_of_3_big::cache cache;
+
+			ela::elapsed_time_ns t = ela::steady_time();
+			mpz_srcptr p = cache.get(exponent);
+			t = ela::steady_time() - t;
+
+			sink = mpz_getlimbn(p, 0);
+			return t;
+		});
+
+		const size_t LOOKUP_COUNT = 1000;
+
+		runner.run("pow3/lookup_warm", param, LOOKUP_COUNT, [&] {
+			power_of_3_big::lookup(exponent);
+
+			ela::elapsed_time_ns t = ela::steady_time();
+
+			mp_limb_t acc = 0;
+			for (size_t i = 0; i < LOOKUP_COUNT; i++) {
+				acc += mpz_getlimbn(power_of_3_big::lookup(exponent), 0);
+			}
+
+			t = ela::steady_time() - t;
+
+			sink = acc;
+			return t;
+		});
+	}
+}
+
+static const size_t PARALLEL_MUL_LIMB_COUNTS[] = { 1 << 14, 1 << 16, 1 << 18 };
+static const size_t PARALLEL_MUL_THREAD_COUNTS[] = { 1, 4, 16, 64 };
+
+// products of balanced operands and of operands 8:1 by parallel_mul, whose
+// median against the one of threads=1 is the speedup
+static void bench_parallel_mul(bench_runner &runner) {
+	parallel_mul::config saved = parallel_mul::get_config();
+
+	for (size_t bn : PARALLEL_MUL_LIMB_COUNTS) {
+		for (size_t ratio : { 1, 8 }) {
+			size_t an = ratio * bn;
+
+			vector<mp_limb_t> a = random_limbs(an, an);
+			vector<mp_limb_t> b = random_limbs(bn, bn);
+			vector<mp_limb_t> product(an + bn);
+
+			for (size_t thread_count : PARALLEL_MUL_THREAD_COUNTS) {
+				parallel_mul::config c = saved;
+				c.thread_count = thread_count;
+				c.cutover_limbs = 1;
+				parallel_mul::configure(c);
+
+				string param = "limbs=" + std::to_string(an) + "x" + std::to_string(bn) + " threads="
+						+ std::to_string(thread_count);
+
+				runner.run("parallel_mul", param, 1, [&] {
+					ela::elapsed_time_ns t = ela::steady_time();
+					parallel_mul::mul(product.data(), a.data(), an, b.data(), bn);
+					t = ela::steady_time() - t;
+
+					sink = product[bn];
+					return t;
+				});
+			}
+		}
+	}
+
+	parallel_mul::configure(saved);
+}
+
+static const size_t CHECKER_BITS[] = { 1000, 10000, 100000, 1000000, 10000000 };
+
+template<typename CHECKER>
+static void bench_checker(bench_runner &runner, size_t max_bits) {
+	for (size_t bits : CHECKER_BITS) {
+		if (bits > max_bits) {
+			break;
+		}
+
+		mpz_class start_value = random_value(bits, bits);
+
+		string name = "checker/" + CHECKER().type_abbrev();
+
+		runner.run(name, "bits=" + std::to_string(bits), 1, [&] {
+			CHECKER checker;
+			checker.start_value_ref() = start_value;
+			checker.start_value_modified();
+
+			ela::elapsed_time_ns t = ela::steady_time();
+			checker.complete_check();
+			t = ela::steady_time() - t;
+
+			sink = checker.step_count();
+			return t;
+		});
+	}
+}
+
+static string cpu_model() {
+	std::ifstream in("/proc/cpuinfo");
+	string line;
+
+	while (std::getline(in, line)) {
+		if (line.compare(0, 10, "model name") == 0) {
+			return line.substr(line.find(':') + 2);
+		}
+	}
+
+	return "unknown";
+}
+
+static void print_usage() {
+	cout << "" //
+			<< "usage: collatz_bench [--filter NAME_PART] [--warmup N] [--reps N]\n" //
+			<< "                     [--max-case-seconds S] [--max-bits N] [--impact-width W]\n" //
+			<< "\n" //
+			<< "prints a json line with the machine and then one per benchmark case.\n" //
+			<< "the checkers are swept from 10^3 bits up to --max-bits (default 10^6).\n" //
+			;
+}
+
+int main(int argc, char **argv) {
+	bench_options opts;
+	size_t impact_width = collatz_multistep::COMBINED_IMPACT_TABLE_STEP_COUNT;
+
+	std::map<string, string> args;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+
+		if (arg.compare(0, 2, "--") != 0 || i + 1 == argc) {
+			print_usage();
+			return 1;
+		}
+
+		args[arg.substr(2)] = argv[++i];
+	}
+
+	for (auto &a : args) {
+		if (a.first == "filter") {
+			opts.filter = a.second;
+		} else if (a.first == "warmup") {
+			opts.warmup_count = std::stoull(a.second);
+		} else if (a.first == "reps") {
+			opts.rep_count = std::max(std::stoull(a.second), 1ull);
+		} else if (a.first == "max-case-seconds") {
+			opts.max_case_s = std::stod(a.second);
+		} else if (a.first == "max-bits") {
+			opts.max_bits = std::stoull(a.second);
+		} else if (a.first == "impact-width") {
+			impact_width = std::stoull(a.second);
+		} else {
+			print_usage();
+			return 1;
+		}
+	}
+
+	collatz_multistep::with_impact_width(impact_width, [](auto) {
+	});
+	collatz_multistep::selected_impact_width = impact_width;
+
+	cout << "{\"machine\":\"" << cpu_model() << "\"" //
+			<< ",\"compiler\":\"" << __VERSION__ << "\"" //
+			<< ",\"impact_width\":" << impact_width //
+			<< ",\"time\":\"" << ela::format_time(ela::system_time()) << "\"" //
+			<< "}\n";
+
+	bench_runner runner(opts);
+
+	bench_impact<32>(runner);
+	bench_impact<64>(runner);
+
+	bench_accumulator(runner);
+
+	bench_pow3(runner);
+
+	bench_parallel_mul(runner);
+
+	// the naive checker steps a big value one bit at a time
+	bench_checker<collatz_checker_naive>(runner, std::min(opts.max_bits, (size_t) 10000));
+	bench_checker<collatz_checker_slow>(runner, opts.max_bits);
+	bench_checker<collatz_checker_dc>(runner, opts.max_bits);
+	bench_checker<collatz_checker_fast>(runner, opts.max_bits);
+
+	return 0;
+}
@@ -0,0 +1,287 @@
+#include "chain_geometry.h"
+
+#include <gmpxx.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include "collatz_checker_fast.h"
+#include "elapsed_time.h"
+
+using std::string;
+
+void chain_geometry::validate() const {
+	if (min_pull_limbs < 2 || !(growth >= 1.25 && growth <= 16) || !(push_ratio >= 1.1 && push_ratio <= 8)
+			|| !(exp_of_3_ratio >= 0.1 && exp_of_3_ratio <= 8)) {
+		throw std::runtime_error("unusable chain geometry:\n" + str());
+	}
+}
+
+string chain_geometry::str() const {
+	std::ostringstream os;
+
+	os << "" //
+			<< "min_pull_limbs " << min_pull_limbs << "\n" //
+			<< "growth " << growth << "\n" //
+			<< "push_ratio " << push_ratio << "\n" //
+			<< "exp_of_3_ratio " << exp_of_3_ratio << "\n" //
+			;
+
+	return os.str();
+}
+
+// doubles are kept bit-exactly as words
+static uint64_t to_word(double d) {
+	uint64_t w;
+	std::memcpy(&w, &d, sizeof(w));
+	return w;
+}
+
+static double from_word(uint64_t w) {
+	double d;
+	std::memcpy(&d, &w, sizeof(d));
+	return d;
+}
+
+void chain_geometry::save(checker_snapshot::snapshot_buffer &snapshot) const {
+	snapshot.put(min_pull_limbs);
+	snapshot.put(to_word(growth));
+	snapshot.put(to_word(push_ratio));
+	snapshot.put(to_word(exp_of_3_ratio));
+}
+
+void chain_geometry::load(checker_snapshot::snapshot_buffer &snapshot) {
+	min_pull_limbs = snapshot.get_u64();
+	growth = from_word(snapshot.get_u64());
+	push_ratio = from_word(snapshot.get_u64());
+	exp_of_3_ratio = from_word(snapshot.get_u64());
+
+	validate();
+}
+
+bool load_chain_geometry(const string &path, chain_geometry &g) {
+	std::ifstream in(path);
+	if (!in) {
+		return false;
+	}
+
+	string name;
+	double value;
+
+	while (in >> name >> value) {
+		if (name == "min_pull_limbs") {
+			// a size_t only holds whole numbers below 2^64, so that anything
+			// else is rejected before the conversion
+			if (!(value >= 0 && value < std::ldexp(1.0, 64) && value == std::floor(value))) {
+				std::ostringstream os;
+				os << "invalid min_pull_limbs " << value << " in " << path;
+				throw std::runtime_error(os.str());
+			}
+
+			g.min_pull_limbs = (size_t) value;
+		} else if (name == "growth") {
+			g.growth = value;
+		} else if (name == "push_ratio") {
+			g.push_ratio = value;
+		} else if (name == "exp_of_3_ratio") {
+			g.exp_of_3_ratio = value;
+		} else {
+			throw std::runtime_error("unknown parameter " + name + " in " + path);
+		}
+	}
+
+	if (!in.eof()) {
+		throw std::runtime_error("not a chain geometry: " + path);
+	}
+
+	g.validate();
+
+	return true;
+}
+
+void save_chain_geometry(const string &path, const chain_geometry &g) {
+	std::ofstream out(path);
+	out << g.str();
+
+	if (!out.flush()) {
+		throw std::runtime_error("cannot write " + path);
+	}
+}
+
+chain_level_sizes::chain_level_sizes(const chain_geometry &g) {
+	g.validate();
+
+	const double LOG_BASE2_OF_3 = 1.58496250072115618145;
+
+	// far above any value, but small enough that no size overflows
+	const double MAX_SIZE = std::ldexp(1, 50);
+
+	for (size_t idx = 0; idx < MAX_LEVELS; idx++) {
+		double pull = std::min(std::round(g.min_pull_limbs * std::pow(g.growth, (double) idx)), MAX_SIZE);
+
+		// every level pulls more than its child
+		size_t pull_size = std::max((size_t) pull, idx == 0 ? 0 : pull_sizes.back() + 1);
+		size_t push_value_size = (size_t) (pull_size * g.push_ratio);
+		double push_exp_of_3 = std::ceil(push_value_size * LIMB_BITSIZE / LOG_BASE2_OF_3 * g.exp_of_3_ratio);
+
+		pull_sizes.push_back(pull_size);
+		push_trigger_value_sizes.push_back(push_value_size);
+		push_trigger_exp_of_3s.push_back((size_t) push_exp_of_3);
+	}
+}
+
+class geometry_timer {
+public:
+	const std::vector<mpz_class> &values;
+
+	// step counts with the default geometry, which every geometry has to match
+	std::vector<size_t> step_counts;
+
+	// time of the default geometry per value
+	std::vector<elapsed_time::elapsed_time_ns> default_times;
+
+	explicit geometry_timer(const std::vector<mpz_class> &values) :
+			values(values) {
+		for (const mpz_class &v : values) {
+			collatz_checker_fast checker;
+			default_times.push_back(time_check(chain_geometry(), v, checker));
+			step_counts.push_back(checker.step_count());
+		}
+
+		scores[chain_geometry().str()] = 1;
+	}
+
+	bool is_timed(const chain_geometry &g) {
+		return scores.count(g.str()) != 0;
+	}
+
+	// the mean time of g relative to the default geometry
+	double score(const chain_geometry &g) {
+		string key = g.str();
+
+		auto it = scores.find(key);
+		if (it != scores.end()) {
+			return it->second;
+		}
+
+		double sum = 0;
+
+		for (size_t i = 0; i < values.size(); i++) {
+			collatz_checker_fast checker;
+			elapsed_time::elapsed_time_ns t = time_check(g, values[i], checker);
+
+			if (checker.step_count() != step_counts[i]) {
+				throw std::runtime_error("bug. step count depends on the chain geometry:\n" + key);
+			}
+
+			sum += t / (double) default_times[i];
+		}
+
+		return scores[key] = sum / values.size();
+	}
+
+private:
+	std::map<string, double> scores;
+
+	static elapsed_time::elapsed_time_ns time_check(const chain_geometry &g, const mpz_class &v,
+			collatz_checker_fast &checker) {
+		const size_t REPS = 5;
+
+		elapsed_time::elapsed_time_ns best = 0;
+
+		for (size_t rep = 0; rep < REPS; rep++) {
+			checker = collatz_checker_fast();
+			checker.chain.set_geometry(g);
+			checker.start_value_assign(v.get_mpz_t());
+
+			elapsed_time::elapsed_time_ns t = elapsed_time::steady_time();
+			checker.complete_check();
+			t = elapsed_time::steady_time() - t;
+
+			best = rep == 0 ? t : std::min(best, t);
+		}
+
+		return best;
+	}
+};
+
+chain_geometry tune_chain_geometry(const std::vector<size_t> &bit_lengths, std::ostream *log) {
+	// a candidate only wins if it is clearly faster, as the timings are noisy
+	const double MIN_GAIN = 0.05;
+	const size_t MAX_ROUNDS = 4;
+
+	std::vector<mpz_class> values;
+	for (size_t bit_length : bit_lengths) {
+		values.push_back(random_value(bit_length, bit_length) | 1);
+	}
+
+	geometry_timer timer(values);
+
+	chain_geometry best;
+	double best_score = timer.score(best);
+
+	// each parameter with its candidate values
+	auto set_min_pull_limbs = [](chain_geometry &g, double v) {
+		g.min_pull_limbs = (size_t) v;
+	};
+	auto set_growth = [](chain_geometry &g, double v) {
+		g.growth = v;
+	};
+	auto set_push_ratio = [](chain_geometry &g, double v) {
+		g.push_ratio = v;
+	};
+	auto set_exp_of_3_ratio = [](chain_geometry &g, double v) {
+		g.exp_of_3_ratio = v;
+	};
+
+	struct parameter {
+		const char *name;
+		void (*set)(chain_geometry&, double);
+		std::vector<double> candidates;
+	};
+
+	const std::vector<parameter> PARAMETERS = {
+		{ "min_pull_limbs", set_min_pull_limbs, { 2, 4, 8 } },
+		{ "growth", set_growth, { 1.5, 2, 3, 4 } },
+		{ "push_ratio", set_push_ratio, { 1.2, 1.4, 1.7, 2 } },
+		{ "exp_of_3_ratio", set_exp_of_3_ratio, { 0.5, 0.75, 1, 1.5 } },
+	};
+
+	for (size_t round = 0; round < MAX_ROUNDS; round++) {
+		bool changed = false;
+
+		for (const parameter &p : PARAMETERS) {
+			for (double candidate : p.candidates) {
+				chain_geometry g = best;
+				p.set(g, candidate);
+
+				bool timed = timer.is_timed(g);
+				double s = timer.score(g);
+
+				if (log != nullptr && !timed) {
+					*log << p.name << " " << candidate << ": " << s << "\n" << std::flush;
+				}
+
+				if (s < best_score * (1 - MIN_GAIN)) {
+					best = g;
+					best_score = s;
+					changed = true;
+				}
+			}
+		}
+
+		if (!changed) {
+			break;
+		}
+	}
+
+	if (log != nullptr) {
+		*log << "relative time " << best_score << " of the default geometry\n";
+	}
+
+	return best;
+}
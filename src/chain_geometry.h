@@ -0,0 +1,81 @@
+#ifndef CHAIN_GEOMETRY_H_
+#define CHAIN_GEOMETRY_H_
+
+#include <stddef.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "checker_snapshot.h"
+
+// the sizes at which the levels of an accu_chain pull from and push to their
+// parents.
+//
+// level idx pulls min_pull_limbs * growth^idx limbs at a time from its parent.
+// it pushes its whole value to the parent when that has more than push_ratio
+// times its pull size limbs, or when its exp_of_3 is more than exp_of_3_ratio
+// times the exponent of a power of 3 of that many limbs. the best values
+// depend on the multiplication thresholds of gmp and the cache sizes, see
+// tune_chain_geometry().
+struct chain_geometry {
+	size_t min_pull_limbs = 2;
+	double growth = 2;
+	double push_ratio = 1.4;
+	double exp_of_3_ratio = 1;
+
+	// throws if an accu_chain cannot work with this geometry
+	void validate() const;
+
+	// one "name value" line per parameter, as in a geometry file
+	std::string str() const;
+
+	void save(checker_snapshot::snapshot_buffer &snapshot) const;
+	void load(checker_snapshot::snapshot_buffer &snapshot);
+};
+
+// the geometry of newly created accu_chains
+inline chain_geometry selected_chain_geometry;
+
+// reads a geometry written by save_chain_geometry(). returns false if there is
+// no such file.
+bool load_chain_geometry(const std::string &path, chain_geometry &g);
+
+void save_chain_geometry(const std::string &path, const chain_geometry &g);
+
+// the sizes of a geometry per level, which accu_chain looks up on every push
+class chain_level_sizes {
+public:
+	// enough for any value at the smallest growth validate() accepts
+	static const size_t MAX_LEVELS = 256;
+
+	explicit chain_level_sizes(const chain_geometry &g);
+
+	// size to be pulled from level idx into its child idx - 1
+	inline size_t pull_size(size_t idx) const {
+		return pull_sizes[idx];
+	}
+
+	// value size of level idx at which to trigger a push to its parent
+	inline size_t push_trigger_value_size(size_t idx) const {
+		return push_trigger_value_sizes[idx];
+	}
+
+	// exp_of_3 of level idx at which to trigger a push to its parent
+	inline size_t push_trigger_exp_of_3(size_t idx) const {
+		return push_trigger_exp_of_3s[idx];
+	}
+
+private:
+	std::vector<size_t> pull_sizes;
+	std::vector<size_t> push_trigger_value_sizes;
+	std::vector<size_t> push_trigger_exp_of_3s;
+};
+
+// searches the geometry with the fastest collatz_checker_fast by coordinate
+// descent: each parameter in turn is set to the candidate value that is
+// fastest with the others fixed, until a round changes nothing. the time of
+// a geometry is the sum over bit_lengths of the best of a few checks of a
+// pseudo random value, relative to the time of the default geometry.
+chain_geometry tune_chain_geometry(const std::vector<size_t> &bit_lengths, std::ostream *log = nullptr);
+
+#endif /* CHAIN_GEOMETRY_H_ */
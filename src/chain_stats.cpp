@@ -0,0 +1,36 @@
+#include "chain_stats.h"
+
+#include <sstream>
+
+template<bool ENABLED_>
+std::string basic_chain_stats<ENABLED_>::json() const {
+	std::ostringstream os;
+
+	os << "{\"accumulators_added\":" << accumulators_added //
+			<< ",\"accumulators_removed\":" << accumulators_removed //
+			<< ",\"levels\":[";
+
+	for (size_t i = 0; i < levels.size(); i++) {
+		const chain_level_stats &l = levels[i];
+
+		os << (i == 0 ? "" : ",") //
+				<< "{\"level\":" << i //
+				<< ",\"push_count\":" << l.push_count //
+				<< ",\"pull_count\":" << l.pull_count //
+				<< ",\"value_size_trigger_count\":" << l.value_size_trigger_count //
+				<< ",\"exp_of_3_trigger_count\":" << l.exp_of_3_trigger_count //
+				<< ",\"mul_count\":" << l.mul_count //
+				<< ",\"mul_limbs\":" << l.mul_limbs //
+				<< ",\"max_exp_of_3\":" << l.max_exp_of_3 //
+				<< ",\"mul_ns\":" << l.mul_ns //
+				<< ",\"shift_ns\":" << l.shift_ns //
+				<< "}";
+	}
+
+	os << "]}";
+
+	return os.str();
+}
+
+template class basic_chain_stats<true> ;
+template class basic_chain_stats<false> ;
@@ -0,0 +1,68 @@
+#ifndef CHAIN_STATS_H_
+#define CHAIN_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "elapsed_time.h"
+
+// counters of the work done by each level of an accu_chain
+struct chain_level_stats {
+	uint64_t push_count = 0;
+	uint64_t pull_count = 0;
+
+	// pushes to the parent by the trigger that fired. both can fire at once.
+	uint64_t value_size_trigger_count = 0;
+	uint64_t exp_of_3_trigger_count = 0;
+
+	// multiplications by powers of 3 and the limbs of the multiplied values
+	uint64_t mul_count = 0;
+	uint64_t mul_limbs = 0;
+
+	uint64_t max_exp_of_3 = 0;
+
+	// time spent multiplying and time spent shifting and adding values into
+	// the buffers
+	elapsed_time::elapsed_time_ns mul_ns = 0;
+	elapsed_time::elapsed_time_ns shift_ns = 0;
+};
+
+// the stats policy of accu_chain. with ENABLED false, all counting is
+// compiled out, because it only happens in branches on ENABLED.
+template<bool ENABLED_>
+class basic_chain_stats {
+public:
+	static const bool ENABLED = ENABLED_;
+
+	std::vector<chain_level_stats> levels;
+
+	uint64_t accumulators_added = 0;
+	uint64_t accumulators_removed = 0;
+
+	chain_level_stats& level(size_t idx) {
+		if (idx >= levels.size()) {
+			levels.resize(idx + 1);
+		}
+
+		return levels[idx];
+	}
+
+	static elapsed_time::elapsed_time_ns now() {
+		return ENABLED ? elapsed_time::steady_time() : 0;
+	}
+
+	void clear() {
+		levels.clear();
+		accumulators_added = 0;
+		accumulators_removed = 0;
+	}
+
+	std::string json() const;
+};
+
+typedef basic_chain_stats<true> chain_stats;
+typedef basic_chain_stats<false> no_chain_stats;
+
+#endif /* CHAIN_STATS_H_ */
@@ -0,0 +1,238 @@
+#include "checker_dispatch.h"
+
+#include <gmpxx.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "collatz_checker_fast.h"
+#include "collatz_checker_fixed.h"
+#include "collatz_checker_slow.h"
+#include "elapsed_time.h"
+
+using std::string;
+
+namespace checker_dispatch {
+
+typedef collatz_checker_fixed<FIXED_LIMBS> fixed_checker;
+
+string profile::str() const {
+	std::ostringstream os;
+
+	os << "" //
+			<< "fixed_max_limbs " << fixed_max_limbs << "\n" //
+			<< "slow_max_limbs " << slow_max_limbs << "\n" //
+			;
+
+	return os.str();
+}
+
+bool load(const string &path, profile &p) {
+	std::ifstream in(path);
+	if (!in) {
+		return false;
+	}
+
+	string name;
+	size_t value;
+
+	while (in >> name >> value) {
+		if (name == "fixed_max_limbs") {
+			p.fixed_max_limbs = std::min(value, FIXED_LIMBS);
+		} else if (name == "slow_max_limbs") {
+			if (value == 0) {
+				throw std::runtime_error("slow_max_limbs has to be at least 1 in " + path);
+			}
+			p.slow_max_limbs = value;
+		} else {
+			throw std::runtime_error("unknown crossover " + name + " in " + path);
+		}
+	}
+
+	if (!in.eof()) {
+		throw std::runtime_error("not a dispatch profile: " + path);
+	}
+
+	return true;
+}
+
+void save(const string &path, const profile &p) {
+	std::ofstream out(path);
+	out << p.str();
+
+	if (!out.flush()) {
+		throw std::runtime_error("cannot write " + path);
+	}
+}
+
+// odd, with the top bit set
+static mpz_class random_odd_value(size_t limb_count) {
+	return random_value(limb_count * LIMB_BITSIZE, limb_count) | 1;
+}
+
+// the fastest of at least MIN_RUNS complete checks of v, repeated for at
+// least MIN_TIME, as small values are checked within microseconds
+template<typename CHECKER>
+static elapsed_time::elapsed_time_ns time_check(const mpz_class &v) {
+	const size_t MIN_RUNS = 3;
+	const size_t MAX_RUNS = 1000;
+	const elapsed_time::elapsed_time_ns MIN_TIME = elapsed_time::NS_PER_SEC / 500;
+
+	elapsed_time::elapsed_time_ns best = 0;
+	elapsed_time::elapsed_time_ns total = 0;
+
+	for (size_t run = 0; run < MAX_RUNS && (run < MIN_RUNS || total < MIN_TIME); run++) {
+		CHECKER checker;
+		checker.start_value_ref() = v;
+		checker.start_value_modified();
+
+		elapsed_time::elapsed_time_ns t = elapsed_time::steady_time();
+		checker.complete_check();
+		t = elapsed_time::steady_time() - t;
+
+		best = run == 0 ? t : std::min(best, t);
+		total += t;
+	}
+
+	return best;
+}
+
+profile calibrate(std::ostream *log) {
+	profile p;
+
+	p.fixed_max_limbs = 0;
+
+	for (size_t n = 1; n <= FIXED_LIMBS; n++) {
+		mpz_class v = random_odd_value(n);
+
+		elapsed_time::elapsed_time_ns t_fixed = time_check<fixed_checker>(v);
+		elapsed_time::elapsed_time_ns t_slow = time_check<collatz_checker_slow>(v);
+
+		if (log != nullptr) {
+			*log << n << " limbs: fixed " << elapsed_time::format_dura(t_fixed) << ", slow "
+					<< elapsed_time::format_dura(t_slow) << "\n" << std::flush;
+		}
+
+		if (t_fixed >= t_slow) {
+			break;
+		}
+
+		p.fixed_max_limbs = n;
+	}
+
+	// times of checks of n limbs, so that each size is only timed once
+	size_t n = FIXED_LIMBS;
+
+	mpz_class v = random_odd_value(n);
+	elapsed_time::elapsed_time_ns last_slow = time_check<collatz_checker_slow>(v);
+	elapsed_time::elapsed_time_ns last_fast = time_check<collatz_checker_fast>(v);
+
+	p.slow_max_limbs = CALIBRATION_MAX_LIMBS;
+
+	size_t first_win = 0;
+
+	for (; n * 2 <= CALIBRATION_MAX_LIMBS; n *= 2) {
+		v = random_odd_value(n * 2);
+		elapsed_time::elapsed_time_ns t_slow = time_check<collatz_checker_slow>(v);
+		elapsed_time::elapsed_time_ns t_fast = time_check<collatz_checker_fast>(v);
+
+		elapsed_time::elapsed_time_ns d_slow = t_slow - last_slow;
+		elapsed_time::elapsed_time_ns d_fast = t_fast - last_fast;
+
+		if (log != nullptr) {
+			*log << n << " to " << n * 2 << " limbs: slow " << elapsed_time::format_dura(d_slow) << ", fast "
+					<< elapsed_time::format_dura(d_fast) << "\n" << std::flush;
+		}
+
+		last_slow = t_slow;
+		last_fast = t_fast;
+
+		if (d_fast >= d_slow) {
+			first_win = 0;
+			continue;
+		}
+
+		if (first_win == 0) {
+			first_win = n;
+		} else {
+			p.slow_max_limbs = first_win;
+			break;
+		}
+	}
+
+	return p;
+}
+
+template<typename CHECKER>
+static void add(CHECKER &checker, result &r) {
+	r.step_count_evn += checker.step_count_evn;
+	r.step_count_odd += checker.step_count_odd;
+	r.iter_count += checker.iter_count;
+	r.max_bitlen = std::max(r.max_bitlen, checker.max_bitlen);
+
+	if (!r.checkers.empty()) {
+		r.checkers += '>';
+	}
+	r.checkers += checker.type_abbrev();
+}
+
+void check(mpz_srcptr start_value, result &r, bool track_max_bitlen, const profile &p) {
+	if (mpz_sgn(start_value) <= 0) {
+		throw std::runtime_error("the start value has to be at least 1");
+	}
+
+	r = result();
+
+	// the value handed from one checker to the next
+	mpz_class value;
+	mpz_srcptr current = start_value;
+
+	if (mpz_size(current) > p.slow_max_limbs) {
+		collatz_checker_fast checker;
+		checker.track_max_bitlen = track_max_bitlen;
+		checker.handoff_limbs = p.slow_max_limbs;
+		checker.start_value_assign(current);
+
+		checker.complete_check();
+
+		// an empty chain after a complete check stands for 1
+		if (checker.handed_off) {
+			checker.chain.materialize(value);
+		} else {
+			value = 1;
+		}
+		current = value.get_mpz_t();
+		add(checker, r);
+	}
+
+	if (mpz_size(current) > p.fixed_max_limbs && (r.checkers.empty() || value != 1)) {
+		collatz_checker_slow checker;
+		checker.track_max_bitlen = track_max_bitlen;
+		checker.handoff_limbs = p.fixed_max_limbs;
+		checker.start_value_assign(current);
+
+		checker.complete_check();
+
+		value.swap(checker.value);
+		current = value.get_mpz_t();
+		add(checker, r);
+	}
+
+	if (r.checkers.empty() || value != 1) {
+		fixed_checker checker;
+		checker.track_max_bitlen = track_max_bitlen;
+		mpz_set(checker.start_value_ref().get_mpz_t(), current);
+		checker.start_value_modified();
+
+		checker.complete_check();
+
+		add(checker, r);
+		if (checker.handed_off) {
+			r.checkers += ">slow";
+		}
+	}
+}
+
+} /* namespace checker_dispatch */
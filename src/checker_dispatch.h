@@ -0,0 +1,67 @@
+#ifndef CHECKER_DISPATCH_H_
+#define CHECKER_DISPATCH_H_
+
+#include <gmp.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <ostream>
+#include <string>
+
+// picks the fastest checker for the size of a start value and hands the value
+// down to the checker for smaller values once it has shrunk below a crossover.
+//
+// values of more than slow_max_limbs limbs start on collatz_checker_fast,
+// values of more than fixed_max_limbs on collatz_checker_slow and smaller
+// ones on collatz_checker_fixed<FIXED_LIMBS>. fast and slow run with their
+// handoff_limbs set to the next crossover, so the descent of a huge value
+// ends on the checkers for small values.
+namespace checker_dispatch {
+
+const size_t FIXED_LIMBS = 4;
+
+// the crossovers, as limb counts
+struct profile {
+	// at most FIXED_LIMBS
+	size_t fixed_max_limbs = FIXED_LIMBS;
+
+	size_t slow_max_limbs = 512;
+
+	// one "name value" line per crossover, as in a profile file
+	std::string str() const;
+};
+
+// the profile used by check() by default
+inline profile selected_profile;
+
+// times the checkers on pseudo random values of growing size and returns the
+// crossovers. fixed and slow are compared by whole checks, as their values are
+// small. slow and fast are compared by the time a check of 2n limbs takes more
+// than one of n limbs, which is the time spent on values of n to 2n limbs.
+// the sizes grow until fast has won twice in a row or CALIBRATION_MAX_LIMBS.
+profile calibrate(std::ostream *log = nullptr);
+
+const size_t CALIBRATION_MAX_LIMBS = 1 << 12;
+
+// reads a profile written by save(). returns false if there is no such file.
+bool load(const std::string &path, profile &p);
+
+void save(const std::string &path, const profile &p);
+
+struct result {
+	uint64_t step_count_evn = 0;
+	uint64_t step_count_odd = 0;
+	uint64_t iter_count = 0;
+
+	// the checkers in the order they ran, e.g. "fast>slow>fixed256"
+	std::string checkers;
+
+	// only with track_max_bitlen, see the checkers
+	size_t max_bitlen = 0;
+};
+
+// runs a complete check of start_value, which has to be at least 1
+void check(mpz_srcptr start_value, result &r, bool track_max_bitlen = false, const profile &p = selected_profile);
+
+} /* namespace checker_dispatch */
+
+#endif /* CHECKER_DISPATCH_H_ */
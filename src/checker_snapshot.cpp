@@ -0,0 +1,252 @@
+#include "checker_snapshot.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+using std::string;
+
+namespace checker_snapshot {
+
+static const char MAGIC[8] = { 'c', 'h', 'f', 's', 'n', 'a', 'p', '1' };
+
+static uint64_t fnv1a(const char *p, size_t n) {
+	uint64_t hash = 0xcbf29ce484222325;
+
+	for (size_t i = 0; i < n; i++) {
+		hash ^= (uint8_t) p[i];
+		hash *= 0x100000001b3;
+	}
+
+	return hash;
+}
+
+static void throw_errno(const string &what, const string &path) {
+	throw std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+void snapshot_buffer::get_raw(void *p, size_t n) {
+	if (bytes.size() - read_pos < n) {
+		throw std::runtime_error("snapshot ends unexpectedly");
+	}
+
+	std::memcpy(p, bytes.data() + read_pos, n);
+	read_pos += n;
+}
+
+string snapshot_buffer::get_string() {
+	string s(get_u64(), '\0');
+	get_raw(&s[0], s.size());
+	return s;
+}
+
+size_t snapshot_buffer::get_limbs(const char *&limbs) {
+	size_t n = get_u64();
+
+	if ((bytes.size() - read_pos) / sizeof(mp_limb_t) < n) {
+		throw std::runtime_error("snapshot ends unexpectedly");
+	}
+
+	limbs = bytes.data() + read_pos;
+	read_pos += n * sizeof(mp_limb_t);
+
+	return n;
+}
+
+void snapshot_buffer::get(mpz_class &v) {
+	const char *limbs;
+	size_t n = get_limbs(limbs);
+
+	std::memcpy(mpz_limbs_write(v.get_mpz_t(), std::max(n, (size_t) 1)), limbs, n * sizeof(mp_limb_t));
+	mpz_limbs_finish(v.get_mpz_t(), n);
+}
+
+bool read(const string &path, snapshot_buffer &buffer) {
+	std::ifstream in(path, std::ios::binary);
+	if (!in) {
+		return false;
+	}
+
+	std::vector<char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	const size_t HEADER_SIZE = sizeof(MAGIC) + sizeof(uint64_t);
+
+	// the payload is followed by its hash
+	uint64_t payload_size = 0;
+	if (file.size() >= HEADER_SIZE + sizeof(uint64_t)) {
+		std::memcpy(&payload_size, file.data() + sizeof(MAGIC), sizeof(payload_size));
+	}
+
+	if (file.size() < HEADER_SIZE + sizeof(uint64_t) || std::memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0
+			|| payload_size != file.size() - HEADER_SIZE - sizeof(uint64_t)) {
+		throw std::runtime_error("not a snapshot file: " + path);
+	}
+
+	const char *payload = file.data() + HEADER_SIZE;
+
+	uint64_t hash;
+	std::memcpy(&hash, payload + payload_size, sizeof(hash));
+
+	if (hash != fnv1a(payload, payload_size)) {
+		throw std::runtime_error("snapshot file is damaged: " + path);
+	}
+
+	buffer.clear();
+	buffer.bytes.assign(payload, payload + payload_size);
+
+	return true;
+}
+
+static void write_all(int fd, const void *p, size_t n, const string &path) {
+	const char *c = static_cast<const char*>(p);
+
+	while (n > 0) {
+		ssize_t w = ::write(fd, c, n);
+
+		if (w < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (w < 0) {
+			throw_errno("cannot write", path);
+		}
+
+		c += w;
+		n -= w;
+	}
+}
+
+static void write_file(const string &path, const snapshot_buffer &buffer) {
+	string tmp_path = path + ".tmp";
+
+	int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		throw_errno("cannot create", tmp_path);
+	}
+
+	try {
+		uint64_t payload_size = buffer.bytes.size();
+		uint64_t hash = fnv1a(buffer.bytes.data(), payload_size);
+
+		write_all(fd, MAGIC, sizeof(MAGIC), tmp_path);
+		write_all(fd, &payload_size, sizeof(payload_size), tmp_path);
+		write_all(fd, buffer.bytes.data(), payload_size, tmp_path);
+		write_all(fd, &hash, sizeof(hash), tmp_path);
+
+		if (fsync(fd) != 0) {
+			throw_errno("cannot sync", tmp_path);
+		}
+	} catch (...) {
+		::close(fd);
+		throw;
+	}
+
+	if (::close(fd) != 0) {
+		throw_errno("cannot close", tmp_path);
+	}
+
+	if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+		throw_errno("cannot rename to", path);
+	}
+}
+
+snapshot_writer::snapshot_writer(const string &path, elapsed_time::elapsed_time_ns interval) :
+		path(path), interval(interval), last_time(elapsed_time::steady_time()) {
+	thread = std::thread(&snapshot_writer::writer_loop, this);
+}
+
+snapshot_writer::~snapshot_writer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	changed.notify_all();
+	thread.join();
+}
+
+bool snapshot_writer::clock_due() {
+	elapsed_time::elapsed_time_ns now = elapsed_time::steady_time();
+
+	if (now - last_time < interval) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (!error.empty()) {
+		throw std::runtime_error(error);
+	}
+
+	if (pending) {
+		return false;
+	}
+
+	last_time = now;
+	return true;
+}
+
+void snapshot_writer::submit() {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [&] {
+			return !pending;
+		});
+
+		front.bytes.swap(back.bytes);
+		pending = true;
+	}
+
+	changed.notify_all();
+}
+
+void snapshot_writer::finish() {
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [&] {
+		return !pending;
+	});
+
+	if (!error.empty()) {
+		throw std::runtime_error(error);
+	}
+}
+
+void snapshot_writer::writer_loop() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true) {
+		changed.wait(lock, [&] {
+			return pending || stopping;
+		});
+
+		if (!pending) {
+			return;
+		}
+
+		lock.unlock();
+
+		string failure;
+		try {
+			write_file(path, front);
+		} catch (const std::exception &e) {
+			failure = e.what();
+		}
+
+		lock.lock();
+
+		if (failure.empty()) {
+			written++;
+		} else if (error.empty()) {
+			error = failure;
+		}
+
+		pending = false;
+		changed.notify_all();
+	}
+}
+
+} /* namespace checker_snapshot */
@@ -0,0 +1,146 @@
+#ifndef CHECKER_SNAPSHOT_H_
+#define CHECKER_SNAPSHOT_H_
+
+#include <gmp.h>
+#include <gmpxx.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "elapsed_time.h"
+
+// snapshots of a running checker, from which a restarted process continues
+// bit-exactly.
+//
+// a snapshot file is the magic "chfsnap1", the payload size, the payload and
+// an fnv-1a hash of the payload, all integers as native 64 bit words. the
+// payload is whatever the checker's save() put into a snapshot_buffer.
+namespace checker_snapshot {
+
+// a byte buffer with sequential reads and writes of words, strings and limbs
+class snapshot_buffer {
+public:
+	std::vector<char> bytes;
+
+	void clear() {
+		bytes.clear();
+		read_pos = 0;
+	}
+
+	void put(uint64_t v) {
+		put_raw(&v, sizeof(v));
+	}
+
+	void put(const std::string &s) {
+		put(s.size());
+		put_raw(s.data(), s.size());
+	}
+
+	void put(const mp_limb_t *limbs, size_t n) {
+		put(n);
+		put_raw(limbs, n * sizeof(mp_limb_t));
+	}
+
+	void put(const mpz_class &v) {
+		put(mpz_limbs_read(v.get_mpz_t()), mpz_size(v.get_mpz_t()));
+	}
+
+	uint64_t get_u64() {
+		uint64_t v;
+		get_raw(&v, sizeof(v));
+		return v;
+	}
+
+	std::string get_string();
+
+	// returns the limb count and points limbs into the buffer, which has no
+	// particular alignment
+	size_t get_limbs(const char *&limbs);
+
+	void get(mpz_class &v);
+
+private:
+	size_t read_pos = 0;
+
+	void put_raw(const void *p, size_t n) {
+		const char *c = static_cast<const char*>(p);
+		bytes.insert(bytes.end(), c, c + n);
+	}
+
+	void get_raw(void *p, size_t n);
+};
+
+// reads a snapshot file into buffer. returns false if there is no such file
+// and throws if it is damaged.
+bool read(const std::string &path, snapshot_buffer &buffer);
+
+// writes snapshots at most every interval from a background thread, so that
+// the checker only pauses to copy its state. the file is replaced by renaming
+// a fully written and synced temporary file, so a crash leaves either the old
+// or the new snapshot.
+//
+// the checker serializes into the back buffer, which is swapped with the one
+// of the writer thread. while that thread is busy, no new snapshot is due.
+class snapshot_writer {
+public:
+	// the clock is only read every CLOCK_STRIDE iterations
+	static const size_t CLOCK_STRIDE = 1024;
+
+	snapshot_writer(const std::string &path, elapsed_time::elapsed_time_ns interval);
+
+	~snapshot_writer();
+
+	snapshot_writer(const snapshot_writer&) = delete;
+	snapshot_writer& operator=(const snapshot_writer&) = delete;
+
+	inline bool due(size_t iter_count) {
+		return iter_count % CLOCK_STRIDE == 0 && clock_due();
+	}
+
+	// calls save(buffer) and hands the buffer to the writer thread
+	template<typename SAVE>
+	void write(SAVE &&save) {
+		back.clear();
+		save(back);
+		submit();
+	}
+
+	// waits until the pending snapshot is on disk
+	void finish();
+
+	size_t written_count() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return written;
+	}
+
+private:
+	std::string path;
+	elapsed_time::elapsed_time_ns interval;
+	elapsed_time::elapsed_time_ns last_time;
+
+	snapshot_buffer back;
+	snapshot_buffer front;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	bool pending = false;
+	bool stopping = false;
+	size_t written = 0;
+	std::string error;
+
+	std::thread thread;
+
+	bool clock_due();
+
+	void submit();
+
+	void writer_loop();
+};
+
+} /* namespace checker_snapshot */
+
+#endif /* CHECKER_SNAPSHOT_H_ */
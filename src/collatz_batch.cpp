@@ -0,0 +1,382 @@
+#include "collatz_batch.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "collatz_checker_fixed.h"
+#include "power_of_3_int.h"
+#include "stopping_time_memo.h"
+
+namespace collatz_batch {
+
+const char* get_name(kernel k) {
+	switch (k) {
+	case kernel::scalar:
+		return "scalar";
+	case kernel::avx2:
+		return "avx2";
+	case kernel::avx512:
+		return "avx512";
+	}
+
+	return "unknown";
+}
+
+bool is_supported(kernel k) {
+	switch (k) {
+	case kernel::scalar:
+		return true;
+	case kernel::avx2:
+		return __builtin_cpu_supports("avx2");
+	case kernel::avx512:
+		return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq");
+	}
+
+	return false;
+}
+
+kernel best_kernel() {
+	if (is_supported(kernel::avx512)) {
+		return kernel::avx512;
+	}
+
+	if (is_supported(kernel::avx2)) {
+		return kernel::avx2;
+	}
+
+	return kernel::scalar;
+}
+
+// values in [ROUND_MIN, ROUND_LIMIT) can do a round of W steps without
+// reaching 1 and without overflowing 64 bits
+template<size_t W>
+struct round_bounds {
+	static const uint64_t ROUND_MIN = ((uint64_t) 1) << (W + 1);
+
+	// (v >> W) * 3^W + 3^W < 2^64, as the carry is below 3^W
+	static const uint64_t ROUND_LIMIT = ((((uint64_t) -1) / power_of_3_int::calculate<uint64_t>(W)) - 1) << W;
+};
+
+// the step counts of all values below ROUND_MIN until 1
+template<size_t W>
+std::vector<step_counts> create_tail_table() {
+	std::vector<step_counts> result(round_bounds<W>::ROUND_MIN);
+
+	for (uint64_t v = 1; v < result.size(); v++) {
+		uint64_t x = v;
+		size_t step_count_evn = 0;
+		size_t step_count_odd = 0;
+
+		while (x != 1) {
+			collatz_multistep::simple_single_step(x, step_count_odd);
+			step_count_evn++;
+		}
+
+		result[v].evn = step_count_evn;
+		result[v].odd = step_count_odd;
+	}
+
+	return result;
+}
+
+template<size_t W>
+const std::vector<step_counts> TAIL_TABLE = create_tail_table<W>();
+
+// adds the step counts of v until 1 to counts, for a v outside of the rounds'
+// range
+template<size_t W>
+void finish(uint64_t v, step_counts &counts) {
+	if (v < round_bounds<W>::ROUND_MIN) {
+		counts.evn += TAIL_TABLE<W>[v].evn;
+		counts.odd += TAIL_TABLE<W>[v].odd;
+		return;
+	}
+
+	if (stopping_time_memo::is_enabled()) {
+		size_t step_count_evn = 0;
+		size_t step_count_odd = 0;
+
+		if (stopping_time_memo::finish(v, step_count_evn, step_count_odd)) {
+			counts.evn += step_count_evn;
+			counts.odd += step_count_odd;
+			return;
+		}
+	}
+
+	collatz_checker_fixed<4> checker;
+	checker.impact_width = W;
+	checker.start_value_ref() = mpz_class(v);
+	checker.start_value_modified();
+	checker.complete_check();
+
+	counts.evn += checker.step_count_evn;
+	counts.odd += checker.step_count_odd;
+}
+
+// the rounds stop at round_min, which is raised to the limit of the memo
+// table when it covers more than the tail table
+template<size_t W>
+uint64_t get_round_min() {
+	uint64_t round_min = round_bounds<W>::ROUND_MIN;
+
+	if (stopping_time_memo::is_enabled()) {
+		round_min = std::max(round_min, stopping_time_memo::attached_table().limit());
+	}
+
+	return round_min;
+}
+
+template<size_t W>
+inline bool in_rounds(uint64_t v, uint64_t round_min) {
+	return v >= round_min && v < round_bounds<W>::ROUND_LIMIT;
+}
+
+template<size_t W>
+void check_scalar(const uint64_t *start_values, size_t count, step_counts *results) {
+	uint64_t round_min = get_round_min<W>();
+
+	for (size_t i = 0; i < count; i++) {
+		uint64_t v = start_values[i];
+		size_t step_count_evn = 0;
+		size_t step_count_odd = 0;
+
+		while (in_rounds<W>(v, round_min)) {
+			collatz_multistep::combined_impact_exactly<uint64_t, W, W>(v, step_count_evn, step_count_odd);
+		}
+
+		results[i].evn = step_count_evn;
+		results[i].odd = step_count_odd;
+
+		finish<W>(v, results[i]);
+	}
+}
+
+// keeps LANES values in flight. rounds(v, evn, odd, round_min) does rounds on
+// the lanes in the rounds' range, with the others masked out, until a quarter
+// of the lanes has left it. empty lanes hold 0.
+template<size_t W, size_t LANES, typename ROUNDS>
+void check_lanes(const uint64_t *start_values, size_t count, step_counts *results, ROUNDS rounds) {
+	uint64_t round_min = get_round_min<W>();
+
+	alignas(64) uint64_t v[LANES];
+	alignas(64) uint64_t evn[LANES];
+	alignas(64) uint64_t odd[LANES];
+	size_t idx[LANES];
+
+	size_t next = 0;
+
+	auto refill = [&](size_t lane) {
+		while (next < count) {
+			size_t i = next++;
+
+			if (in_rounds<W>(start_values[i], round_min)) {
+				v[lane] = start_values[i];
+				evn[lane] = 0;
+				odd[lane] = 0;
+				idx[lane] = i;
+				return;
+			}
+
+			results[i] = step_counts();
+			finish<W>(start_values[i], results[i]);
+		}
+
+		v[lane] = 0;
+	};
+
+	for (size_t lane = 0; lane < LANES; lane++) {
+		refill(lane);
+	}
+
+	while (true) {
+		rounds(v, evn, odd, round_min);
+
+		bool any_left = false;
+
+		for (size_t lane = 0; lane < LANES; lane++) {
+			if (v[lane] != 0 && !in_rounds<W>(v[lane], round_min)) {
+				step_counts &r = results[idx[lane]];
+				r.evn = evn[lane];
+				r.odd = odd[lane];
+				finish<W>(v[lane], r);
+
+				refill(lane);
+			}
+
+			any_left |= v[lane] != 0;
+		}
+
+		if (!any_left) {
+			return;
+		}
+	}
+}
+
+// unsigned a < b for 64 bit lanes
+__attribute__((target("avx2")))
+inline __m256i less_than_avx2(__m256i a, __m256i b) {
+	const __m256i SIGN = _mm256_set1_epi64x((int64_t) 0x8000000000000000ull);
+	return _mm256_cmpgt_epi64(_mm256_xor_si256(b, SIGN), _mm256_xor_si256(a, SIGN));
+}
+
+template<size_t W>
+__attribute__((target("avx2")))
+void rounds_avx2(uint64_t *v_ptr, uint64_t *evn_ptr, uint64_t *odd_ptr, uint64_t round_min) {
+	const long long *table = reinterpret_cast<const long long*>(collatz_multistep::COMBINED_IMPACT_TABLE<W>.data());
+
+	const __m256i MASK = _mm256_set1_epi64x((1 << W) - 1);
+	const __m256i FIELD_MASK = _mm256_set1_epi64x(collatz_multistep::multistep_impact::FIELD_MASK);
+	const __m256i ROUND_MIN = _mm256_set1_epi64x(round_min);
+	const __m256i ROUND_LIMIT = _mm256_set1_epi64x(round_bounds<W>::ROUND_LIMIT);
+	const __m256i STEPS = _mm256_set1_epi64x(W);
+	const __m256i ZERO = _mm256_setzero_si256();
+
+	__m256i v[2], evn[2], odd[2];
+	for (size_t j = 0; j < 2; j++) {
+		v[j] = _mm256_load_si256(reinterpret_cast<const __m256i*>(v_ptr + 4 * j));
+		evn[j] = _mm256_load_si256(reinterpret_cast<const __m256i*>(evn_ptr + 4 * j));
+		odd[j] = _mm256_load_si256(reinterpret_cast<const __m256i*>(odd_ptr + 4 * j));
+	}
+
+	while (true) {
+		__m256i active[2];
+		int active_bits = 0;
+		int occupied_bits = 0;
+
+		for (size_t j = 0; j < 2; j++) {
+			__m256i below_min = less_than_avx2(v[j], ROUND_MIN);
+			__m256i below_limit = less_than_avx2(v[j], ROUND_LIMIT);
+			active[j] = _mm256_andnot_si256(below_min, below_limit);
+
+			__m256i empty = _mm256_cmpeq_epi64(v[j], ZERO);
+
+			active_bits |= _mm256_movemask_pd(_mm256_castsi256_pd(active[j])) << (4 * j);
+			occupied_bits |= (~_mm256_movemask_pd(_mm256_castsi256_pd(empty)) & 0xf) << (4 * j);
+		}
+
+		if (__builtin_popcount(occupied_bits & ~active_bits) >= 2 || active_bits == 0) {
+			break;
+		}
+
+		for (size_t j = 0; j < 2; j++) {
+			__m256i impact = _mm256_mask_i64gather_epi64(ZERO, table, _mm256_and_si256(v[j], MASK), active[j], 8);
+
+			__m256i carry = _mm256_and_si256(impact, FIELD_MASK);
+			__m256i power = _mm256_and_si256(
+					_mm256_srli_epi64(impact, collatz_multistep::multistep_impact::CARRY_BITS), FIELD_MASK);
+			__m256i expnt = _mm256_srli_epi64(impact,
+					collatz_multistep::multistep_impact::CARRY_BITS + collatz_multistep::multistep_impact::POWER_BITS);
+
+			// (v >> W) * power, from the products of its 32 bit halves
+			__m256i hi = _mm256_srli_epi64(v[j], W);
+			__m256i product = _mm256_add_epi64(_mm256_mul_epu32(hi, power),
+					_mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(hi, 32), power), 32));
+
+			v[j] = _mm256_blendv_epi8(v[j], _mm256_add_epi64(product, carry), active[j]);
+			evn[j] = _mm256_add_epi64(evn[j], _mm256_and_si256(STEPS, active[j]));
+			odd[j] = _mm256_add_epi64(odd[j], _mm256_and_si256(expnt, active[j]));
+		}
+	}
+
+	for (size_t j = 0; j < 2; j++) {
+		_mm256_store_si256(reinterpret_cast<__m256i*>(v_ptr + 4 * j), v[j]);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(evn_ptr + 4 * j), evn[j]);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(odd_ptr + 4 * j), odd[j]);
+	}
+}
+
+template<size_t W>
+__attribute__((target("avx512f,avx512dq")))
+void rounds_avx512(uint64_t *v_ptr, uint64_t *evn_ptr, uint64_t *odd_ptr, uint64_t round_min) {
+	const long long *table = reinterpret_cast<const long long*>(collatz_multistep::COMBINED_IMPACT_TABLE<W>.data());
+
+	const __m512i MASK = _mm512_set1_epi64((1 << W) - 1);
+	const __m512i FIELD_MASK = _mm512_set1_epi64(collatz_multistep::multistep_impact::FIELD_MASK);
+	const __m512i ROUND_MIN = _mm512_set1_epi64(round_min);
+	const __m512i ROUND_LIMIT = _mm512_set1_epi64(round_bounds<W>::ROUND_LIMIT);
+	const __m512i STEPS = _mm512_set1_epi64(W);
+	const __m512i ZERO = _mm512_setzero_si512();
+
+	// the shifts are zero masked with all lanes set, because the unmasked ones
+	// trigger a false -Wmaybe-uninitialized in gcc 12
+	const __mmask8 ALL = 0xff;
+
+	__m512i v[2], evn[2], odd[2];
+	for (size_t j = 0; j < 2; j++) {
+		v[j] = _mm512_load_si512(v_ptr + 8 * j);
+		evn[j] = _mm512_load_si512(evn_ptr + 8 * j);
+		odd[j] = _mm512_load_si512(odd_ptr + 8 * j);
+	}
+
+	while (true) {
+		__mmask8 active[2];
+		int inactive_count = 0;
+		bool any_active = false;
+
+		for (size_t j = 0; j < 2; j++) {
+			active[j] = _mm512_cmpge_epu64_mask(v[j], ROUND_MIN) & _mm512_cmplt_epu64_mask(v[j], ROUND_LIMIT);
+			__mmask8 occupied = _mm512_cmpneq_epu64_mask(v[j], ZERO);
+
+			inactive_count += __builtin_popcount(occupied & ~active[j]);
+			any_active |= active[j] != 0;
+		}
+
+		if (inactive_count >= 4 || !any_active) {
+			break;
+		}
+
+		for (size_t j = 0; j < 2; j++) {
+			__m512i impact = _mm512_mask_i64gather_epi64(ZERO, active[j], _mm512_and_si512(v[j], MASK), table, 8);
+
+			__m512i carry = _mm512_and_si512(impact, FIELD_MASK);
+			__m512i power = _mm512_and_si512(
+					_mm512_maskz_srli_epi64(ALL, impact, collatz_multistep::multistep_impact::CARRY_BITS), FIELD_MASK);
+			__m512i expnt = _mm512_maskz_srli_epi64(ALL, impact,
+					collatz_multistep::multistep_impact::CARRY_BITS + collatz_multistep::multistep_impact::POWER_BITS);
+
+			__m512i product = _mm512_mullo_epi64(_mm512_maskz_srli_epi64(ALL, v[j], W), power);
+
+			v[j] = _mm512_mask_add_epi64(v[j], active[j], product, carry);
+			evn[j] = _mm512_mask_add_epi64(evn[j], active[j], evn[j], STEPS);
+			odd[j] = _mm512_mask_add_epi64(odd[j], active[j], odd[j], expnt);
+		}
+	}
+
+	for (size_t j = 0; j < 2; j++) {
+		_mm512_store_si512(v_ptr + 8 * j, v[j]);
+		_mm512_store_si512(evn_ptr + 8 * j, evn[j]);
+		_mm512_store_si512(odd_ptr + 8 * j, odd[j]);
+	}
+}
+
+void check(const uint64_t *start_values, size_t count, step_counts *results, kernel k, size_t impact_width) {
+	for (size_t i = 0; i < count; i++) {
+		if (start_values[i] == 0) {
+			throw std::runtime_error("start values have to be at least 1");
+		}
+	}
+
+	if (!is_supported(k)) {
+		throw std::runtime_error(std::string("kernel not supported by this cpu: ") + get_name(k));
+	}
+
+	collatz_multistep::with_impact_width(impact_width, [&](auto width) {
+		const size_t W = decltype(width)::value;
+
+		switch (k) {
+		case kernel::scalar:
+			check_scalar<W>(start_values, count, results);
+			break;
+		case kernel::avx2:
+			check_lanes<W, 8>(start_values, count, results, rounds_avx2<W>);
+			break;
+		case kernel::avx512:
+			check_lanes<W, 16>(start_values, count, results, rounds_avx512<W>);
+			break;
+		}
+	});
+}
+
+} /* namespace collatz_batch */
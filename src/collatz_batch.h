@@ -0,0 +1,52 @@
+#ifndef COLLATZ_BATCH_H_
+#define COLLATZ_BATCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "collatz_multistep.h"
+
+// step counts of many independent start values below 2^64.
+//
+// the values are kept in lanes and advanced in lockstep by rounds of one
+// combined impact table lookup each, with the lookups as vector gathers. a
+// lane leaves the lockstep when its value drops below 2^(W+1), where the rest
+// of its steps come from a precomputed table, or when its value gets too big
+// for another round, where it is finished by collatz_checker_fixed. the lane
+// is then refilled with the next start value.
+namespace collatz_batch {
+
+struct step_counts {
+	uint64_t evn = 0;
+	uint64_t odd = 0;
+};
+
+enum class kernel {
+	// one value at a time
+	scalar,
+
+	// 2 vectors of 4 lanes
+	avx2,
+
+	// 2 vectors of 8 lanes
+	avx512
+};
+
+const kernel KERNEL_LIST[] = { kernel::scalar, kernel::avx2, kernel::avx512 };
+
+const char* get_name(kernel k);
+
+// whether the cpu supports k
+bool is_supported(kernel k);
+
+// the widest supported kernel
+kernel best_kernel();
+
+// results[i] = the step counts of start_values[i] until 1, like the step_count_*
+// members of the checkers. all start values have to be at least 1.
+void check(const uint64_t *start_values, size_t count, step_counts *results, kernel k = best_kernel(),
+		size_t impact_width = collatz_multistep::selected_impact_width);
+
+} /* namespace collatz_batch */
+
+#endif /* COLLATZ_BATCH_H_ */
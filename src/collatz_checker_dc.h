@@ -0,0 +1,225 @@
+#ifndef COLLATZ_CHECKER_DC_H_
+#define COLLATZ_CHECKER_DC_H_
+
+#include <gmp.h>
+#include <gmpxx.h>
+#include <stddef.h>
+#include <algorithm>
+#include <string>
+
+#include "collatz_checker_slow.h"
+#include "collatz_multistep.h"
+#include "mpz_utils.h"
+#include "parallel_mul.h"
+#include "power_of_3_big.h"
+
+// a divide and conquer checker with subquadratic runtime.
+//
+// the next B steps of a value n = h * 2^B + l only depend on l and map n to
+// 3^e * h + c. (e, c) is found recursively by doing the first half of the B
+// steps on the low half of l, applying the result to the high half of l, and
+// doing the second half of the steps on what is then the low half. the result
+// is applied to h with one big multiplication. this needs O(M(n) log n) for an
+// n bit value, where M(n) is the cost of an n bit multiplication, like the
+// half-gcd algorithm does for the euclidean algorithm.
+class collatz_checker_dc {
+public:
+	mpz_class value = 1;
+
+	size_t step_count_evn = 0;
+	size_t step_count_odd = 0;
+	size_t iter_count = 0;
+
+	// width of the combined impact table used by complete_check()
+	size_t impact_width = collatz_multistep::selected_impact_width;
+
+	// stop as soon as the value drops below the start value, so that the step
+	// counts are those of the glide
+	bool stop_below_start = false;
+
+	// blocks of at most this many limbs are done limb by limb
+	static const size_t BASE_LIMBS = 8;
+
+	// values of at most this many limbs are finished by collatz_checker_slow
+	static const size_t TAIL_LIMBS = 64;
+
+	collatz_checker_dc() {
+	}
+
+	inline void reset() {
+		step_count_evn = 0;
+		step_count_odd = 0;
+		iter_count = 0;
+	}
+
+	inline mpz_class& start_value_ref() {
+		return value;
+	}
+
+	void start_value_modified() {
+	}
+
+	size_t step_count() {
+		return step_count_evn + step_count_odd;
+	}
+
+	std::string type_abbrev() {
+		return "dc";
+	}
+
+	void complete_check() {
+		if (stop_below_start) {
+			complete_glide();
+			return;
+		}
+
+		collatz_multistep::with_impact_width(impact_width, [&](auto width) {
+			while (size(value) > TAIL_LIMBS) {
+				iterate<decltype(width)::value>();
+			}
+		});
+
+		collatz_checker_slow tail;
+		tail.impact_width = impact_width;
+
+		mpz_swap(tail.value.get_mpz_t(), value.get_mpz_t());
+		tail.complete_check();
+		mpz_swap(tail.value.get_mpz_t(), value.get_mpz_t());
+
+		step_count_evn += tail.step_count_evn;
+		step_count_odd += tail.step_count_odd;
+		iter_count += tail.iter_count;
+	}
+
+	// like complete_check(), but stops when the value drops below its start
+	// value. blocks are limited so that they cannot pass below the start value
+	// and the rest is done by collatz_checker_slow::iterate_above().
+	void complete_glide() {
+		mpz_class start = value;
+		size_t start_bitlen = bitlen(start);
+
+		collatz_checker_slow tail;
+		tail.impact_width = impact_width;
+
+		collatz_multistep::with_impact_width(impact_width, [&](auto width) {
+			while (value != 1 && value >= start) {
+				// a block of b limbs at most divides by 2^(b * LIMB_BITSIZE)
+				size_t block_limbs = (bitlen(value) - start_bitlen) / LIMB_BITSIZE;
+
+				if (size(value) > TAIL_LIMBS && block_limbs >= 1) {
+					iterate<decltype(width)::value>(std::min(block_limbs, size(value) - 1));
+					continue;
+				}
+
+				mpz_swap(tail.value.get_mpz_t(), value.get_mpz_t());
+				tail.iterate_above<decltype(width)::value>(start, start_bitlen);
+				mpz_swap(tail.value.get_mpz_t(), value.get_mpz_t());
+			}
+		});
+
+		step_count_evn += tail.step_count_evn;
+		step_count_odd += tail.step_count_odd;
+		iter_count += tail.iter_count;
+	}
+
+	// does the steps for all but the highest limb in one block. the highest
+	// limb is not zero, so the value cannot reach 1 before the end of the block.
+	template<size_t IMPACT_WIDTH = collatz_multistep::COMBINED_IMPACT_TABLE_STEP_COUNT>
+	void iterate() {
+		iterate<IMPACT_WIDTH>(size(value) - 1);
+	}
+
+	// does the steps for the lowest block_limbs limbs in one block, with
+	// block_limbs < size(value)
+	template<size_t IMPACT_WIDTH>
+	void iterate(size_t block_limbs) {
+		mpz_class lo;
+		mpz_tdiv_r_2exp(lo.get_mpz_t(), value.get_mpz_t(), block_limbs * LIMB_BITSIZE);
+		mpz_tdiv_q_2exp(value.get_mpz_t(), value.get_mpz_t(), block_limbs * LIMB_BITSIZE);
+
+		mpz_class carry;
+		mpz_class power;
+		size_t exponent = 0;
+		block<IMPACT_WIDTH>(carry, power, exponent, lo, block_limbs);
+
+		parallel_mul::mul(value, power.get_mpz_t());
+		value += carry;
+
+		step_count_evn += block_limbs * LIMB_BITSIZE;
+		step_count_odd += exponent;
+
+		iter_count++;
+	}
+
+private:
+	// computes (exponent, power = 3^exponent, carry) so that the next
+	// block_limbs * LIMB_BITSIZE steps map h * 2^(block_limbs * LIMB_BITSIZE) + lo
+	// to power * h + carry for any h. lo has at most block_limbs limbs and is
+	// consumed.
+	//
+	// the powers are multiplied up along with the recursion, which is cheaper
+	// than calculating 3^exponent from scratch on each level.
+	template<size_t IMPACT_WIDTH>
+	void block(mpz_class &carry, mpz_class &power, size_t &exponent, mpz_class &lo, size_t block_limbs) {
+		if (block_limbs <= BASE_LIMBS) {
+			base_block<IMPACT_WIDTH>(carry, exponent, lo, block_limbs);
+			mpz_set(power.get_mpz_t(), power_of_3_big::lookup(exponent));
+			return;
+		}
+
+		size_t lo_limbs = block_limbs / 2;
+		size_t hi_limbs = block_limbs - lo_limbs;
+
+		// first half of the steps, on the low half
+		mpz_class lo_lo;
+		mpz_tdiv_r_2exp(lo_lo.get_mpz_t(), lo.get_mpz_t(), lo_limbs * LIMB_BITSIZE);
+		mpz_tdiv_q_2exp(lo.get_mpz_t(), lo.get_mpz_t(), lo_limbs * LIMB_BITSIZE);
+
+		mpz_class carry_lo;
+		mpz_class power_lo;
+		size_t exponent_lo = 0;
+		block<IMPACT_WIDTH>(carry_lo, power_lo, exponent_lo, lo_lo, lo_limbs);
+
+		parallel_mul::mul(lo, power_lo.get_mpz_t());
+		lo += carry_lo;
+
+		// second half of the steps, on the low half of the intermediate result
+		mpz_class mid_lo;
+		mpz_tdiv_r_2exp(mid_lo.get_mpz_t(), lo.get_mpz_t(), hi_limbs * LIMB_BITSIZE);
+		mpz_tdiv_q_2exp(lo.get_mpz_t(), lo.get_mpz_t(), hi_limbs * LIMB_BITSIZE);
+
+		size_t exponent_hi = 0;
+		block<IMPACT_WIDTH>(carry, power, exponent_hi, mid_lo, hi_limbs);
+
+		parallel_mul::mul(lo, power.get_mpz_t());
+		carry += lo;
+
+		parallel_mul::mul(power, power_lo.get_mpz_t());
+		exponent += exponent_lo + exponent_hi;
+	}
+
+	// computes exponent and carry like block(), but limb by limb in
+	// O(block_limbs^2)
+	template<size_t IMPACT_WIDTH>
+	void base_block(mpz_class &carry, size_t &exponent, mpz_class &lo, size_t block_limbs) {
+		size_t step_count_evn_unused = 0;
+
+		for (size_t i = 0; i < block_limbs; i++) {
+			dbl_limb_t sub_accu = mpz_getlimbn(lo.get_mpz_t(), 0);
+			mpz_tdiv_q_2exp(lo.get_mpz_t(), lo.get_mpz_t(), LIMB_BITSIZE);
+
+			size_t sub_exponent = 0;
+			collatz_multistep::combined_impact_exactly<dbl_limb_t, LIMB_BITSIZE, IMPACT_WIDTH>(sub_accu,
+					step_count_evn_unused, sub_exponent);
+
+			power_of_3_big::multiply(lo, sub_exponent);
+			lo += sub_accu;
+
+			exponent += sub_exponent;
+		}
+
+		mpz_swap(carry.get_mpz_t(), lo.get_mpz_t());
+	}
+};
+
+#endif /* COLLATZ_CHECKER_DC_H_ */
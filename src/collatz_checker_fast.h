@@ -7,65 +7,107 @@
 #include <gmpxx.h>
 #include <stddef.h>
 #include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "chain_geometry.h"
+#include "chain_stats.h"
+#include "checker_snapshot.h"
+#include "collatz_checker_slow.h"
 #include "collatz_multistep.h"
 #include "mpz_utils.h"
+#include "parallel_mul.h"
 #include "power_of_3_big.h"
-
-typedef unsigned __int128 dbl_limb_t;
-
-inline mpz_class& operator+=(mpz_class &lhs, const dbl_limb_t &rhs) {
-	if (sizeof(dbl_limb_t) != 2 * sizeof(mp_limb_t)) {
-		throw std::runtime_error("sizeof(dbl_limb_t) is not double of sizeof(mp_limb_t)");
-	}
-
-	mpz_t rhs_mpz;
-	mpz_roinit_n(rhs_mpz, reinterpret_cast<const mp_limb_t*>(&rhs), 2);
-
-	mpz_add(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs_mpz);
-
-	return lhs;
-}
-
-inline mpz_class operator+(mpz_class lhs, const dbl_limb_t &rhs) {
-	lhs += rhs;
-	return lhs;
-}
+#include "progress_reporter.h"
+#include "stopping_time_memo.h"
 
 // arith_buffer
 // accumulator
 // accu_chain
 
-// a buffer that can do calculations on its content
+// a buffer that can do calculations on its content.
+//
+// the value is held in limbs[offset, offset + used), so popping limbs from the
+// back just advances offset in O(1). the space in front of offset is reused
+// for shifting the value up in push_back() and reclaimed by compacting when
+// the buffer has to grow at the top.
 class arith_buffer {
 public:
-	mpz_class value = 0;
 	size_t available = 0;
 
 	inline void reset() {
-		value = 0;
+		offset = 0;
+		used = 0;
 		available = 0;
 	}
 
 	// swap two instances' contents efficiently in O(1)
 	inline void swap(arith_buffer &other) {
-		mpz_swap(value.get_mpz_t(), other.value.get_mpz_t());
+		limbs.swap(other.limbs);
+		spare.swap(other.spare);
+		std::swap(offset, other.offset);
+		std::swap(used, other.used);
 		std::swap(available, other.available);
 	}
 
+	// number of limbs of the value
+	inline size_t size() const {
+		return used;
+	}
+
+	inline const mp_limb_t* data() const {
+		return limbs.data() + offset;
+	}
+
+	// points view to the value without copying it. view is read-only and
+	// invalidated by any modification of this buffer.
+	inline void view(mpz_t view) const {
+		mpz_roinit_n(view, data(), used);
+	}
+
+	inline void assign(mpz_srcptr assigned_value) {
+		size_t n = mpz_size(assigned_value);
+
+		offset = 0;
+		used = 0;
+		reserve_top(n);
+
+		std::copy_n(mpz_limbs_read(assigned_value), n, limbs.data());
+		used = n;
+	}
+
 	inline void adjust_available_to_value() {
-		available = size(value);
+		available = used;
+	}
+
+	void save(checker_snapshot::snapshot_buffer &snapshot) const {
+		snapshot.put(available);
+		snapshot.put(data(), used);
+	}
+
+	void load(checker_snapshot::snapshot_buffer &snapshot) {
+		available = snapshot.get_u64();
+
+		const char *loaded;
+		size_t n = snapshot.get_limbs(loaded);
+
+		offset = 0;
+		used = 0;
+		reserve_top(n);
+
+		std::memcpy(limbs.data(), loaded, n * sizeof(mp_limb_t));
+		used = n;
 	}
 
 	inline bool empty() {
-		return available == 0 && value == 0;
+		return available == 0 && used == 0;
 	}
 
 	inline void ensure_available(size_t expected_available) {
@@ -80,9 +122,12 @@ public:
 	inline void pop_back(size_t size, mpz_class &result) {
 		ensure_available(size);
 
-		mpz_tdiv_r_2exp(result.get_mpz_t(), value.get_mpz_t(), size * LIMB_BITSIZE);
+		size_t n = std::min(size, used);
 
-		value >>= size * LIMB_BITSIZE;
+		std::copy_n(data(), n, mpz_limbs_write(result.get_mpz_t(), std::max(n, (size_t) 1)));
+		mpz_limbs_finish(result.get_mpz_t(), n);
+
+		drop_back(n);
 
 		available -= size;
 	}
@@ -90,29 +135,167 @@ public:
 	inline mp_limb_t pop_back() {
 		ensure_available(1);
 
-		mp_limb_t result = value.get_ui();
+		mp_limb_t result = 0;
 
-		value >>= LIMB_BITSIZE;
+		if (used != 0) {
+			result = limbs[offset];
+			drop_back(1);
+		}
 
 		available--;
 
 		return result;
 	}
 
+	// value *= factor. the product is placed behind front_headroom free limbs,
+	// so that a following push_back() of that many limbs doesn't need to move
+	// it.
+	inline void mul(mpz_srcptr factor, size_t front_headroom = 0) {
+		size_t factor_size = mpz_size(factor);
+
+		if (used == 0 || factor_size == 0) {
+			reset_value();
+			return;
+		}
+
+		size_t product_size = used + factor_size;
+		if (spare.size() < front_headroom + product_size) {
+			spare.resize(front_headroom + product_size);
+		}
+
+		mp_limb_t *rp = spare.data() + front_headroom;
+		const mp_limb_t *fp = mpz_limbs_read(factor);
+
+		if (used >= factor_size) {
+			parallel_mul::mul(rp, data(), used, fp, factor_size);
+		} else {
+			parallel_mul::mul(rp, fp, factor_size, data(), used);
+		}
+
+		limbs.swap(spare);
+		offset = front_headroom;
+		used = product_size - (rp[product_size - 1] == 0);
+	}
+
 	template<typename LARGEINT_OR_BIGINT_TYPE>
 	inline void push_back(const LARGEINT_OR_BIGINT_TYPE &pushed_value, size_t pushed_available) {
-		value <<= pushed_available * LIMB_BITSIZE;
+		shift_up(pushed_available);
 
-		value += pushed_value;
+		add_at(0, pushed_value);
 
 		available += pushed_available;
 	}
 
 	inline void push_front(const mpz_class &pushed_value, size_t pushed_available) {
-		value += pushed_value << (available * LIMB_BITSIZE);
+		add_at(available, pushed_value);
 
 		available += pushed_available;
 	}
+
+private:
+	std::vector<mp_limb_t> limbs;
+
+	// scratch space for products, swapped with limbs after each product
+	std::vector<mp_limb_t> spare;
+
+	size_t offset = 0;
+	size_t used = 0;
+
+	inline void reset_value() {
+		offset = 0;
+		used = 0;
+	}
+
+	inline void drop_back(size_t n) {
+		offset += n;
+		used -= n;
+
+		if (used == 0) {
+			offset = 0;
+		}
+	}
+
+	// makes room for a value of top_size limbs starting at offset, compacting
+	// the buffer first if that is enough
+	inline void reserve_top(size_t top_size) {
+		if (offset + top_size <= limbs.size()) {
+			return;
+		}
+
+		if (offset != 0) {
+			std::copy_n(limbs.data() + offset, used, limbs.data());
+			offset = 0;
+		}
+
+		if (top_size > limbs.size()) {
+			limbs.resize(std::max(top_size, limbs.size() + limbs.size() / 2));
+		}
+	}
+
+	// value <<= shift * LIMB_BITSIZE
+	inline void shift_up(size_t shift) {
+		if (used == 0 || shift == 0) {
+			return;
+		}
+
+		if (offset < shift) {
+			size_t new_offset = shift;
+
+			if (limbs.size() < new_offset + used + 1) {
+				limbs.resize(std::max(new_offset + used + 1, limbs.size() + limbs.size() / 2));
+			}
+
+			std::copy_backward(limbs.data() + offset, limbs.data() + offset + used, limbs.data() + new_offset + used);
+			offset = new_offset;
+		}
+
+		offset -= shift;
+		std::fill_n(limbs.data() + offset, shift, 0);
+		used += shift;
+	}
+
+	// value += addend * 2^(pos * LIMB_BITSIZE)
+	inline void add_at(size_t pos, const mp_limb_t *addend, size_t addend_size) {
+		while (addend_size > 0 && addend[addend_size - 1] == 0) {
+			addend_size--;
+		}
+
+		if (addend_size == 0) {
+			return;
+		}
+
+		size_t end = std::max(used, pos + addend_size);
+		reserve_top(end + 1);
+
+		mp_limb_t *d = limbs.data() + offset;
+
+		std::fill(d + used, d + end, 0);
+
+		mp_limb_t carry = mpn_add_n(d + pos, d + pos, addend, addend_size);
+
+		if (carry != 0 && pos + addend_size < end) {
+			carry = mpn_add_1(d + pos + addend_size, d + pos + addend_size, end - pos - addend_size, carry);
+		}
+
+		if (carry != 0) {
+			d[end++] = carry;
+		}
+
+		used = end;
+	}
+
+	inline void add_at(size_t pos, const dbl_limb_t &addend) {
+		mp_limb_t addend_limbs[2] = { (mp_limb_t) addend, (mp_limb_t) (addend >> LIMB_BITSIZE) };
+		add_at(pos, addend_limbs, 2);
+	}
+
+	inline void add_at(size_t pos, const mpz_class &addend) {
+		add_at(pos, mpz_limbs_read(addend.get_mpz_t()), mpz_size(addend.get_mpz_t()));
+	}
+
+	inline void add_at(size_t pos, const arith_buffer &addend) {
+		add_at(pos, addend.data(), addend.used);
+	}
 };
 
 class accumulator {
@@ -143,20 +326,37 @@ public:
 		return buf.pop_back();
 	}
 
-	template<typename LARGEINT_OR_BIGINT_TYPE>
+	// level is the index of this accumulator in the chain, for the stats
+	template<typename LARGEINT_OR_BIGINT_TYPE, typename STATS>
 	inline void push_back(const LARGEINT_OR_BIGINT_TYPE &pushed_value, size_t pushed_exp_of_3,
-			size_t pushed_available) {
-		if (pushed_exp_of_3 < power_of_3_big::LOOKUP_TABLE_INITIAL_SIZE) {
-			const mpz_class &pow_of_3 = power_of_3_big::LOOKUP_TABLE[pushed_exp_of_3];
-			buf.value *= pow_of_3;
-		} else {
-			const mpz_class pow_of_3 = power_of_3_big::calculate(pushed_exp_of_3);
-			buf.value *= pow_of_3;
+			size_t pushed_available, STATS &stats, size_t level) {
+		ela::elapsed_time_ns t = STATS::now();
+
+		if (pushed_exp_of_3 != 0) {
+			size_t mul_limbs = buf.size();
+
+			buf.mul(power_of_3_big::lookup(pushed_exp_of_3), pushed_available);
+
+			if (STATS::ENABLED) {
+				chain_level_stats &l = stats.level(level);
+				l.mul_count++;
+				l.mul_limbs += mul_limbs;
+
+				ela::elapsed_time_ns t_mul = STATS::now();
+				l.mul_ns += t_mul - t;
+				t = t_mul;
+			}
 		}
 
 		buf.push_back(pushed_value, pushed_available);
 
 		exp_of_3 += pushed_exp_of_3;
+
+		if (STATS::ENABLED) {
+			chain_level_stats &l = stats.level(level);
+			l.shift_ns += STATS::now() - t;
+			l.max_exp_of_3 = std::max(l.max_exp_of_3, (uint64_t) exp_of_3);
+		}
 	}
 
 	inline bool empty() {
@@ -167,68 +367,94 @@ public:
 		buf.ensure_available(expected_available);
 	}
 
-	void push_to_parent(accumulator &parent) {
-		parent.push_back(buf.value, exp_of_3, buf.available);
+	template<typename STATS>
+	void push_to_parent(accumulator &parent, STATS &stats, size_t level) {
+		if (STATS::ENABLED) {
+			stats.level(level).push_count++;
+		}
+
+		parent.push_back(buf, exp_of_3, buf.available, stats, level + 1);
 
 		exp_of_3 = 0;
-		buf.value = 0;
-		buf.available = 0;
+		buf.reset();
 	}
 
-	void pull_from_parent(accumulator &parent, size_t pull_size) {
+	template<typename STATS>
+	void pull_from_parent(accumulator &parent, size_t pull_size, STATS &stats, size_t level) {
 		size_t actual_pull_size = std::min(pull_size, parent.buf.available);
 
 		mpz_class pulled_value;
 		parent.pop_back(actual_pull_size, pulled_value);
 
-		if (exp_of_3 < power_of_3_big::LOOKUP_TABLE_INITIAL_SIZE) {
-			const mpz_class &pow_of_3 = power_of_3_big::LOOKUP_TABLE[exp_of_3];
-			pulled_value *= pow_of_3;
-		} else {
-			const mpz_class pow_of_3 = power_of_3_big::calculate(exp_of_3);
-			pulled_value *= pow_of_3;
+		ela::elapsed_time_ns t = STATS::now();
+
+		if (exp_of_3 != 0) {
+			if (STATS::ENABLED) {
+				chain_level_stats &l = stats.level(level);
+				l.mul_count++;
+				l.mul_limbs += mpz_size(pulled_value.get_mpz_t());
+			}
+
+			parallel_mul::mul(pulled_value, power_of_3_big::lookup(exp_of_3));
 		}
 
+		ela::elapsed_time_ns t_mul = STATS::now();
+
 		buf.push_front(pulled_value, pull_size);
+
+		if (STATS::ENABLED) {
+			chain_level_stats &l = stats.level(level);
+			l.pull_count++;
+			l.mul_ns += t_mul - t;
+			l.shift_ns += STATS::now() - t_mul;
+		}
 	}
 };
 
-class accu_chain {
+// the represented value is described at bitlen_lower_bound(). STATS is
+// chain_stats to count the work done per level, or no_chain_stats.
+template<typename STATS = no_chain_stats>
+class basic_accu_chain {
 public:
 	// size to be pulled from accu_list[idx] into its child accu_list[idx - 1]
-	static inline constexpr size_t get_pull_size(size_t idx) {
-		return ((size_t) 1) << (idx + 1);
+	inline size_t get_pull_size(size_t idx) const {
+		return sizes.pull_size(idx);
 	}
 
 	// value size of accu_list[idx] at which to trigger a push to its parent accu_list[idx + 1]
-	static inline constexpr size_t get_push_trigger_value_size(size_t idx) {
-		return get_pull_size(idx) * 7 / 5;
-	}
-
-	static inline constexpr int64_t ceil_constexpr(double d) {
-		int64_t i = static_cast<int64_t>(d);
-
-		i = (static_cast<double>(i) == d) ? i : i + ((d > 0.0) ? 1 : 0);
-
-		return i;
+	inline size_t get_push_trigger_value_size(size_t idx) const {
+		return sizes.push_trigger_value_size(idx);
 	}
 
 	// exp_of_3 of accu_list[idx] at which to trigger a push to its parent accu_list[idx + 1]
-	static inline constexpr size_t get_push_trigger_exp_of_3(size_t idx) {
-		const double LOG_BASE2_OF_3 = 1.58496250072115618145;
-
-		double result = get_push_trigger_value_size(idx) * LIMB_BITSIZE / LOG_BASE2_OF_3;
-
-		return (size_t) ceil_constexpr(result);
+	inline size_t get_push_trigger_exp_of_3(size_t idx) const {
+		return sizes.push_trigger_exp_of_3(idx);
 	}
 
 	// chained accumulators; this list always contains at least one element.
 	std::vector<accumulator> accu_list;
 
-	accu_chain() {
+	STATS stats;
+
+	explicit basic_accu_chain(const chain_geometry &g = selected_chain_geometry) :
+			geometry(g), sizes(g) {
 		accu_list.push_back(accumulator());
 	}
 
+	const chain_geometry& get_geometry() const {
+		return geometry;
+	}
+
+	// only while the chain holds a single accumulator, e.g. before a check
+	void set_geometry(const chain_geometry &g) {
+		if (accu_list.size() != 1) {
+			throw std::runtime_error("the geometry of a chain can only change with a single accumulator");
+		}
+
+		sizes = chain_level_sizes(g);
+		geometry = g;
+	}
+
 	inline void reset() {
 		while (accu_list.size() > 1) {
 			accu_list.pop_back();
@@ -237,14 +463,60 @@ public:
 		accu_list[0].reset();
 	}
 
+	// the top accumulator is only empty if all are, because pulls never leave an
+	// empty accumulator on top of the chain
 	inline bool empty() {
-		for (auto acc : accu_list) {
-			if (!acc.empty()) {
-				return false;
+		return accu_list.back().empty();
+	}
+
+	// a lower bound of the bit length of the represented value, which is
+	// V_0 + 2^(64 * A_0) * 3^(E_0) * (V_1 + 2^(64 * A_1) * 3^(E_1) * (...)) with
+	// V_i the value, A_i the available limbs and E_i the exp_of_3 of
+	// accu_list[i]. this is at least the bit length of any V_i shifted and
+	// multiplied by all factors below it, so it costs O(accu_list.size()).
+	size_t bitlen_lower_bound() {
+		// slightly below log2(3), so that rounding cannot make this too large
+		const double LOG_BASE2_OF_3_LOWER = 1.5849625;
+
+		size_t result = 0;
+
+		size_t shift = 0;
+		size_t exp_of_3 = 0;
+
+		for (accumulator &acc : accu_list) {
+			mpz_t v;
+			acc.buf.view(v);
+
+			if (acc.buf.size() != 0) {
+				size_t bound = shift + (size_t) (exp_of_3 * LOG_BASE2_OF_3_LOWER) + mpz_sizeinbase(v, 2);
+				result = std::max(result, bound);
 			}
+
+			shift += acc.buf.available * LIMB_BITSIZE;
+			exp_of_3 += acc.exp_of_3;
 		}
 
-		return true;
+		return result;
+	}
+
+	// moves the represented value into result and empties the chain
+	void materialize(mpz_class &result) {
+		result = 0;
+
+		for (size_t i = accu_list.size() - 1; i < accu_list.size(); i--) {
+			accumulator &acc = accu_list[i];
+
+			if (acc.exp_of_3 != 0) {
+				parallel_mul::mul(result, power_of_3_big::lookup(acc.exp_of_3));
+			}
+			result <<= acc.buf.available * LIMB_BITSIZE;
+
+			mpz_t v;
+			acc.buf.view(v);
+			mpz_add(result.get_mpz_t(), result.get_mpz_t(), v);
+		}
+
+		reset();
 	}
 
 	std::string str() {
@@ -265,7 +537,7 @@ public:
 			os << "" //
 					<< "[" << std::setw(2) << i << "]\t" // level of accu
 					<< acc.buf.available << "\t" // number of limbs available (can be more than saved because of leading zeros)
-					<< size(acc.buf.value) << "\t" // number of limbs stored
+					<< acc.buf.size() << "\t" // number of limbs stored
 					<< get_push_trigger_value_size(i) << "\t" // trigger based on size when to push upwards
 					<< acc.exp_of_3 << "\t" // exponent of delayed *3^exponent
 					<< get_push_trigger_exp_of_3(i) << "\t" // trigger based on exp_of_3 when to push upwards
@@ -320,11 +592,17 @@ public:
 		bool value_size_reached = is_push_trigger_value_size_reached(idx);
 		bool exp_of_3_reached = is_push_trigger_exp_of_3_reached(idx);
 
+		if (STATS::ENABLED) {
+			chain_level_stats &l = stats.level(idx);
+			l.value_size_trigger_count += value_size_reached;
+			l.exp_of_3_trigger_count += exp_of_3_reached;
+		}
+
 		return value_size_reached || exp_of_3_reached;
 	}
 
 	inline bool is_push_trigger_value_size_reached(size_t idx) {
-		bool result = size(accu_list[idx].buf.value) > get_push_trigger_value_size(idx);
+		bool result = accu_list[idx].buf.size() > get_push_trigger_value_size(idx);
 		return result;
 	}
 
@@ -335,16 +613,21 @@ public:
 
 	// inserts a new accumulator into the second-last position
 	inline void add_accumulator() {
+		if (STATS::ENABLED) {
+			stats.accumulators_added++;
+		}
+
 		accu_list.push_back(accumulator());
 		accu_list.end()[-2].swap(accu_list.end()[-1]);
 	}
 
 	// pushes the specified pushed_value to the back of this accu chain without shift,
 	// i.e. aligned with the lowest accumulator
-	inline void push_back(const dbl_limb_t &pushed_value, size_t pushed_exp_of_3) {
+	template<typename LARGEINT_OR_BIGINT_TYPE>
+	inline void push_back(const LARGEINT_OR_BIGINT_TYPE &pushed_value, size_t pushed_exp_of_3) {
 		if (accu_list.size() == 1) {
 			if (!is_push_trigger_value_size_reached(0)) {
-				accu_list[0].push_back(pushed_value, pushed_exp_of_3, 0);
+				accu_list[0].push_back(pushed_value, pushed_exp_of_3, 0, stats, 0);
 				accu_list[0].adjust_available_to_value();
 				return;
 			}
@@ -352,7 +635,7 @@ public:
 			add_accumulator();
 		}
 
-		accu_list[0].push_back(pushed_value, pushed_exp_of_3, 0);
+		accu_list[0].push_back(pushed_value, pushed_exp_of_3, 0, stats, 0);
 
 		for (size_t i = 0;; i++) {
 			if (!is_push_trigger_reached(i)) {
@@ -363,7 +646,7 @@ public:
 				add_accumulator();
 			}
 
-			accu_list[i].push_to_parent(accu_list[i + 1]);
+			accu_list[i].push_to_parent(accu_list[i + 1], stats, i);
 		}
 	}
 
@@ -387,32 +670,99 @@ private:
 		}
 	}
 
+	chain_geometry geometry;
+	chain_level_sizes sizes;
+
 	// with s := i_start, pull [s+1]->[s]->[s-1]->[s-2]->...->[0]
 	inline void chained_pull(size_t i_start) {
 		for (size_t i = i_start; i + 1 >= 1; i--) {
 			size_t pull_size = get_pull_size(i);
-			accu_list[i].pull_from_parent(accu_list[i + 1], pull_size);
+			accu_list[i].pull_from_parent(accu_list[i + 1], pull_size, stats, i);
 		}
 
 		if (i_start == accu_list.size() - 2) {
 			while (accu_list.size() > 1 && accu_list.back().empty()) {
 				accu_list.pop_back();
 
+				if (STATS::ENABLED) {
+					stats.accumulators_removed++;
+				}
+
 				accu_list.back().buf.adjust_available_to_value();
 			}
 		}
 	}
 };
 
-class collatz_checker_fast {
+typedef basic_accu_chain<> accu_chain;
+
+// STATS is the stats policy of the chain, see basic_accu_chain
+template<typename STATS = no_chain_stats>
+class basic_collatz_checker_fast {
 public:
-	accu_chain chain;
+	basic_accu_chain<STATS> chain;
 
 	size_t step_count_evn = 0;
 	size_t step_count_odd = 0;
 	size_t iter_count = 0;
 
-	collatz_checker_fast() {
+	// width of the combined impact table used by complete_check()
+	size_t impact_width = collatz_multistep::selected_impact_width;
+
+	// stop as soon as the value drops below the start value, so that the step
+	// counts are those of the glide
+	bool stop_below_start = false;
+
+	// if set, complete_check() keeps a lower bound of the largest bit length
+	// of the value in max_bitlen. it is only sampled every
+	// MAX_BITLEN_STRIDE iterations, as it costs O(accu_list.size()).
+	bool track_max_bitlen = false;
+	size_t max_bitlen = 0;
+
+	static const size_t MAX_BITLEN_STRIDE = 64;
+
+	// if set, complete_check() returns as soon as chain.bitlen_lower_bound()
+	// fits into this many limbs, so that a checker for smaller values can take
+	// over from chain.materialize(). it is only a lower bound: the value can be
+	// a few bits longer and thus one limb more. the chain only collapses at the
+	// very end, so the bound is compared every HANDOFF_STRIDE iterations, and
+	// every iteration once it is within HANDOFF_STRIDE limbs of handoff_limbs.
+	size_t handoff_limbs = 0;
+
+	static const size_t HANDOFF_STRIDE = 64;
+
+	// whether the last check stopped at the handoff_limbs bound. otherwise it
+	// went down to 1 and left the chain empty.
+	bool handed_off = false;
+
+	// runs of at least this many whole limbs of ones or zeros at the bottom of
+	// the chain are done at once by complete_check(), see shortcut_run(). 0
+	// disables it.
+	size_t min_run_limbs = 2;
+
+	// if set, complete_check() publishes its progress there, see
+	// progress_counters
+	progress_counters *progress = nullptr;
+
+	// if set, complete_check() writes a snapshot to this file every
+	// snapshot_interval, from which resume() continues. not used in glide mode.
+	std::string snapshot_path;
+	ela::elapsed_time_ns snapshot_interval = 10 * 60 * ela::NS_PER_SEC;
+
+	// values within this many bits above the start value are handed to
+	// collatz_checker_slow::iterate_above() in glide mode, which gets them back
+	// when they are above it by twice as many bits
+	static const size_t GLIDE_MARGIN_BITS = 4 * LIMB_BITSIZE;
+
+	// with chain_stats, complete_check() writes the stats of the chain as a
+	// json line to stats_out every stats_interval and when it is done
+	std::ostream *stats_out = nullptr;
+	ela::elapsed_time_ns stats_interval = 60 * ela::NS_PER_SEC;
+
+	// the clock is only read every STATS_CLOCK_STRIDE iterations
+	static const size_t STATS_CLOCK_STRIDE = 1024;
+
+	basic_collatz_checker_fast() {
 	}
 
 	std::string str() {
@@ -430,14 +780,31 @@ public:
 		return os.str();
 	}
 
+	// the start value is staged here and moved into the chain by
+	// start_value_modified()
+	mpz_class start_value = 1;
+
 	mpz_class& start_value_ref() {
-		return chain.accu_list[0].buf.value;
+		return start_value;
 	}
 
 	void start_value_modified() {
+		chain.accu_list[0].buf.assign(start_value.get_mpz_t());
 		chain.accu_list[0].buf.adjust_available_to_value();
 	}
 
+	// sets the start value with a single copy of its limbs straight into the
+	// chain, e.g. from a limb_file view. start_value is only set as well in
+	// glide mode, which needs it.
+	void start_value_assign(mpz_srcptr assigned_value) {
+		chain.accu_list[0].buf.assign(assigned_value);
+		chain.accu_list[0].buf.adjust_available_to_value();
+
+		if (stop_below_start) {
+			mpz_set(start_value.get_mpz_t(), assigned_value);
+		}
+	}
+
 	size_t step_count() {
 		return step_count_evn + step_count_odd;
 	}
@@ -448,6 +815,11 @@ public:
 		iter_count = 0;
 
 		chain.reset();
+		chain.stats.clear();
+
+		handed_off = false;
+
+		max_bitlen = 0;
 	}
 
 	std::string type_abbrev() {
@@ -459,28 +831,206 @@ public:
 	}
 
 	void complete_check() {
+		if (stop_below_start) {
+			complete_glide();
+			return;
+		}
+
 		std::vector<size_t> interesting = { };
 		// std::vector<size_t> interesting = { 20 };
 		// std::vector<size_t> interesting = { 243227, 243228, 243229, 243230, 243231, 243232, 243233, 243234 };
 
 		bool debug = contains(interesting, iter_count);
 
-		while (chain.prepare_pop_back()) {
-			if (debug) {
-				std::cout << "after prepare_pop_back:\n" << str();
-			}
+		std::unique_ptr<checker_snapshot::snapshot_writer> snapshots;
+		if (!snapshot_path.empty()) {
+			snapshots.reset(new checker_snapshot::snapshot_writer(snapshot_path, snapshot_interval));
+		}
+
+		ela::elapsed_time_ns stats_time = ela::steady_time();
+
+		handed_off = false;
+
+		// a run of zeros can shrink the value to a few limbs at once, so the
+		// handoff is checked right after every run
+		bool shortcut = false;
+		bool near_handoff = false;
+
+		collatz_multistep::with_impact_width(impact_width, [&](auto width) {
+			while (chain.prepare_pop_back()) {
+				if (handoff_limbs != 0 && (shortcut || near_handoff || iter_count % HANDOFF_STRIDE == 0)) {
+					size_t bound = chain.bitlen_lower_bound();
 
-			iterate();
+					if (bound <= handoff_limbs * LIMB_BITSIZE) {
+						handed_off = true;
+						break;
+					}
 
-			debug = contains(interesting, iter_count);
+					near_handoff = bound <= (handoff_limbs + HANDOFF_STRIDE) * LIMB_BITSIZE;
+				}
 
-			if (debug) {
-				std::cout << "after iterate:\n" << str();
-				std::cout << "";
+				if (debug) {
+					std::cout << "after prepare_pop_back:\n" << str();
+				}
+
+				if (track_max_bitlen && iter_count % MAX_BITLEN_STRIDE == 0) {
+					max_bitlen = std::max(max_bitlen, chain.bitlen_lower_bound());
+				}
+
+				shortcut = shortcut_run();
+				if (!shortcut) {
+					iterate<decltype(width)::value>();
+				}
+
+				debug = contains(interesting, iter_count);
+
+				if (debug) {
+					std::cout << "after iterate:\n" << str();
+					std::cout << "";
+				}
+
+				if (progress != nullptr && iter_count % progress_counters::PUBLISH_STRIDE == 0) {
+					publish_progress();
+				}
+
+				if (snapshots && snapshots->due(iter_count)) {
+					snapshots->write([&](checker_snapshot::snapshot_buffer &snapshot) {
+						save(snapshot);
+					});
+				}
+
+				if (STATS::ENABLED && stats_out != nullptr && iter_count % STATS_CLOCK_STRIDE == 0
+						&& ela::steady_time() - stats_time >= stats_interval) {
+					write_stats();
+					stats_time = ela::steady_time();
+				}
 			}
+		});
+
+		if (progress != nullptr) {
+			publish_progress();
+		}
+
+		if (snapshots) {
+			snapshots->finish();
+		}
+
+		if (STATS::ENABLED && stats_out != nullptr) {
+			write_stats();
+		}
+	}
+
+	// costs O(accu_list.size()), like the bit length bound
+	void publish_progress() {
+		size_t limb_count = 0;
+		for (const accumulator &acc : chain.accu_list) {
+			limb_count += acc.buf.size();
+		}
+
+		progress->publish(step_count_evn, step_count_odd, iter_count, limb_count, chain.bitlen_lower_bound());
+	}
+
+	// the counts and the chain stats as one json line to stats_out
+	void write_stats() {
+		*stats_out << "{\"iter_count\":" << iter_count << ",\"step_count\":" << step_count() << ",\"chain\":"
+				<< chain.stats.json() << "}\n" << std::flush;
+	}
+
+	// the start value, the step counts and every accumulator of the chain
+	void save(checker_snapshot::snapshot_buffer &snapshot) const {
+		snapshot.put(std::string("fast"));
+		snapshot.put(start_value);
+		snapshot.put(step_count_evn);
+		snapshot.put(step_count_odd);
+		snapshot.put(iter_count);
+		snapshot.put(impact_width);
+		chain.get_geometry().save(snapshot);
+
+		snapshot.put(chain.accu_list.size());
+		for (const accumulator &acc : chain.accu_list) {
+			snapshot.put(acc.exp_of_3);
+			acc.buf.save(snapshot);
 		}
 	}
 
+	void load(checker_snapshot::snapshot_buffer &snapshot) {
+		if (snapshot.get_string() != "fast") {
+			throw std::runtime_error("snapshot is not one of collatz_checker_fast");
+		}
+
+		snapshot.get(start_value);
+		step_count_evn = snapshot.get_u64();
+		step_count_odd = snapshot.get_u64();
+		iter_count = snapshot.get_u64();
+		impact_width = snapshot.get_u64();
+
+		chain_geometry geometry;
+		geometry.load(snapshot);
+		chain.reset();
+		chain.set_geometry(geometry);
+
+		chain.accu_list.resize(std::max(snapshot.get_u64(), (uint64_t) 1));
+		for (accumulator &acc : chain.accu_list) {
+			acc.exp_of_3 = snapshot.get_u64();
+			acc.buf.load(snapshot);
+		}
+	}
+
+	// loads the snapshot at snapshot_path, so that complete_check() continues
+	// where it was taken. returns false if there is none.
+	bool resume() {
+		checker_snapshot::snapshot_buffer snapshot;
+		if (!checker_snapshot::read(snapshot_path, snapshot)) {
+			return false;
+		}
+
+		load(snapshot);
+		return true;
+	}
+
+	// like complete_check(), but stops when the value drops below the start
+	// value. the chain is only compared against the start value by
+	// accu_chain::bitlen_lower_bound(). close to the start value, the value is
+	// materialized and stepped by collatz_checker_slow.
+	void complete_glide() {
+		size_t start_bitlen = bitlen(start_value);
+
+		collatz_checker_slow near;
+		near.impact_width = impact_width;
+
+		collatz_multistep::with_impact_width(impact_width, [&](auto width) {
+			while (true) {
+				if (chain.bitlen_lower_bound() > start_bitlen + GLIDE_MARGIN_BITS) {
+					chain.prepare_pop_back();
+					iterate<decltype(width)::value>();
+					continue;
+				}
+
+				chain.materialize(near.value);
+
+				while (near.not_finished() && near.value >= start_value
+						&& bitlen(near.value) <= start_bitlen + 2 * GLIDE_MARGIN_BITS) {
+					near.iterate_above<decltype(width)::value>(start_value, start_bitlen);
+				}
+
+				bool done = !near.not_finished() || near.value < start_value;
+
+				// the chain gets the value back also when done, so that the
+				// checker always holds the final value
+				chain.accu_list[0].buf.assign(near.value.get_mpz_t());
+				chain.accu_list[0].buf.adjust_available_to_value();
+
+				if (done) {
+					break;
+				}
+			}
+		});
+
+		step_count_evn += near.step_count_evn;
+		step_count_odd += near.step_count_odd;
+		iter_count += near.iter_count;
+	}
+
 //	inline void iterate() {
 //		dbl_limb_t sub_accu = chain.pop_back();
 //
@@ -504,6 +1054,53 @@ public:
 //		iter_count++;
 //	}
 
+	// like collatz_checker_slow::shortcut_run(), on the limbs of accu_list[0]
+	// that are final. w limbs of ones are popped and the rest of the chain gets
+	// 3^(w * LIMB_BITSIZE) - 1 pushed with that exponent. w limbs of zeros are
+	// just popped.
+	bool shortcut_run() {
+		if (min_run_limbs == 0) {
+			return false;
+		}
+
+		accumulator &acc = chain.accu_list[0];
+		const mp_limb_t *lo = acc.buf.data();
+		size_t n = std::min(acc.buf.available, acc.buf.size());
+
+		if (n < min_run_limbs || (lo[0] != 0 && lo[0] != ~(mp_limb_t) 0)) {
+			return false;
+		}
+
+		size_t w = 1;
+		while (w < n && lo[w] == lo[0]) {
+			w++;
+		}
+
+		if (w < min_run_limbs) {
+			return false;
+		}
+
+		bool ones = lo[0] != 0;
+		size_t m = w * LIMB_BITSIZE;
+
+		mpz_class popped;
+		acc.pop_back(w, popped);
+
+		step_count_evn += m;
+
+		if (ones) {
+			mpz_class pushed(power_of_3_big::lookup(m));
+			pushed -= 1;
+
+			chain.push_back(pushed, m);
+			step_count_odd += m;
+		}
+
+		iter_count++;
+		return true;
+	}
+
+	template<size_t IMPACT_WIDTH = collatz_multistep::COMBINED_IMPACT_TABLE_STEP_COUNT>
 	void iterate() {
 		dbl_limb_t sub_accu = chain.pop_back();
 
@@ -511,11 +1108,16 @@ public:
 
 		exponent = 0;
 		if (!chain.empty()) {
-			collatz_multistep::combined_impact_exactly<decltype(sub_accu), LIMB_BITSIZE>(sub_accu, step_count_evn,
-					exponent);
+			collatz_multistep::combined_impact_exactly<decltype(sub_accu), LIMB_BITSIZE, IMPACT_WIDTH>(sub_accu,
+					step_count_evn, exponent);
 			step_count_odd += exponent;
+		} else if (stopping_time_memo::is_enabled() && !track_max_bitlen
+				&& stopping_time_memo::finish((mp_limb_t) sub_accu, step_count_evn, step_count_odd)) {
+			iter_count++;
+			return;
 		} else {
-			collatz_multistep::simple_at_most<decltype(sub_accu), LIMB_BITSIZE>(sub_accu, step_count_evn, exponent);
+			collatz_multistep::combined_impact_at_most<decltype(sub_accu), LIMB_BITSIZE, IMPACT_WIDTH>(sub_accu,
+					step_count_evn, exponent);
 			step_count_odd += exponent;
 
 			if (sub_accu == 1) {
@@ -530,4 +1132,6 @@ public:
 	}
 };
 
+typedef basic_collatz_checker_fast<> collatz_checker_fast;
+
 #endif /* COLLATZ_CHECKER_FAST_H_ */
@@ -0,0 +1,340 @@
+#ifndef COLLATZ_CHECKER_FIXED_H_
+#define COLLATZ_CHECKER_FIXED_H_
+
+#include <gmp.h>
+#include <gmpxx.h>
+#include <stddef.h>
+#include <algorithm>
+#include <string>
+
+#include "collatz_checker_slow.h"
+#include "collatz_multistep.h"
+#include "mpz_utils.h"
+#include "power_of_3_int.h"
+#include "stopping_time_memo.h"
+
+// a checker for values of up to N_LIMBS limbs, which are kept in a plain
+// array and calculated on with dbl_limb_t, so that no step allocates or goes
+// through gmp. values that outgrow N_LIMBS limbs are handed off to
+// collatz_checker_slow, which finishes the check.
+template<size_t N_LIMBS>
+class collatz_checker_fixed {
+	static_assert(N_LIMBS >= 2, "collatz_checker_fixed needs at least 2 limbs");
+
+public:
+	size_t step_count_evn = 0;
+	size_t step_count_odd = 0;
+	size_t iter_count = 0;
+
+	// width of the combined impact table used by complete_check()
+	size_t impact_width = collatz_multistep::selected_impact_width;
+
+	// stop as soon as the value drops below the start value, so that the step
+	// counts are those of the glide
+	bool stop_below_start = false;
+
+	// whether the last check was finished by collatz_checker_slow
+	bool handed_off = false;
+
+	// if set, complete_check() keeps the largest bit length of the value after
+	// any iteration in max_bitlen
+	bool track_max_bitlen = false;
+	size_t max_bitlen = 0;
+
+	collatz_checker_fixed() {
+	}
+
+	inline void reset() {
+		step_count_evn = 0;
+		step_count_odd = 0;
+		iter_count = 0;
+
+		handed_off = false;
+
+		max_bitlen = 0;
+	}
+
+	// the start value is staged here and moved into the array by
+	// start_value_modified()
+	mpz_class start_value = 1;
+
+	mpz_class& start_value_ref() {
+		return start_value;
+	}
+
+	void start_value_modified() {
+		used = std::min(mpz_size(start_value.get_mpz_t()), N_LIMBS + 1);
+		std::copy_n(mpz_limbs_read(start_value.get_mpz_t()), used, limbs);
+	}
+
+	size_t step_count() {
+		return step_count_evn + step_count_odd;
+	}
+
+	std::string type_abbrev() {
+		return "fixed" + std::to_string(N_LIMBS * LIMB_BITSIZE);
+	}
+
+	void complete_check() {
+		if (mpz_size(start_value.get_mpz_t()) > N_LIMBS) {
+			hand_off();
+			return;
+		}
+
+		if (stop_below_start) {
+			complete_glide();
+			return;
+		}
+
+		collatz_multistep::with_impact_width(impact_width, [&](auto width) {
+			while (true) {
+				while (used > 1) {
+					if (track_max_bitlen) {
+						max_bitlen = std::max(max_bitlen, bitlen_of(limbs, used));
+					}
+
+					iterate<decltype(width)::value>();
+
+					if (used > N_LIMBS) {
+						hand_off();
+						return;
+					}
+				}
+
+				while (used == 1 && limbs[0] != 1) {
+					if (track_max_bitlen) {
+						max_bitlen = std::max(max_bitlen, bitlen_of(limbs, used));
+					}
+
+					iterate_single_limb<decltype(width)::value>();
+				}
+
+				if (used == 1) {
+					return;
+				}
+			}
+		});
+	}
+
+	// does the steps for the lowest limb, with used > 1
+	template<size_t IMPACT_WIDTH = collatz_multistep::COMBINED_IMPACT_TABLE_STEP_COUNT>
+	inline void iterate() {
+		mp_limb_t lo = limbs[0];
+		std::copy_n(limbs + 1, used - 1, limbs);
+		used--;
+
+		dbl_limb_t hi = lo >> LIMB_BITSIZE_HALF;
+		lo &= LIMB_LO_MASK;
+
+		// the same two halves as collatz_checker_slow::iterate()
+		size_t exponent_lo = 0;
+		collatz_multistep::combined_impact_exactly<decltype(lo), LIMB_BITSIZE_HALF, IMPACT_WIDTH>(lo, step_count_evn,
+				exponent_lo);
+
+		hi *= power_of_3_int::LOOKUP_TABLE<mp_limb_t>[exponent_lo];
+		hi += lo;
+
+		lo = hi & LIMB_LO_MASK;
+		hi >>= LIMB_BITSIZE_HALF;
+
+		size_t exponent_hi = 0;
+		collatz_multistep::combined_impact_exactly<decltype(lo), LIMB_BITSIZE_HALF, IMPACT_WIDTH>(lo, step_count_evn,
+				exponent_hi);
+
+		hi *= power_of_3_int::LOOKUP_TABLE<mp_limb_t>[exponent_hi];
+		hi += lo;
+
+		step_count_odd += exponent_lo + exponent_hi;
+
+		// value = value * 3^(exponent_lo + exponent_hi) + hi. hi is below
+		// 3^(exponent_lo + exponent_hi) and the value below 2^(64 * (N_LIMBS - 1)),
+		// so the result fits into N_LIMBS + 1 limbs.
+		mul_1(power_of_3_int::LOOKUP_TABLE<mp_limb_t>[exponent_lo]);
+		mul_1(power_of_3_int::LOOKUP_TABLE<mp_limb_t>[exponent_hi]);
+		add(hi);
+
+		iter_count++;
+	}
+
+private:
+	static const size_t LIMB_BITSIZE_HALF = LIMB_BITSIZE / 2;
+
+	static const mp_limb_t LIMB_LO_MASK = ~(((mp_limb_t) -1) << LIMB_BITSIZE_HALF);
+
+	// the value in limbs[0, used), with one spare limb for iterate()
+	mp_limb_t limbs[N_LIMBS + 1];
+	size_t used = 0;
+
+	// does up to LIMB_BITSIZE steps on a single limb value in a register
+	template<size_t IMPACT_WIDTH>
+	inline void iterate_single_limb() {
+		if (stopping_time_memo::is_enabled() && !track_max_bitlen
+				&& stopping_time_memo::finish(limbs[0], step_count_evn, step_count_odd)) {
+			set(1);
+			iter_count++;
+			return;
+		}
+
+		dbl_limb_t v = limbs[0];
+
+		collatz_multistep::combined_impact_at_most<dbl_limb_t, LIMB_BITSIZE, IMPACT_WIDTH>(v, step_count_evn,
+				step_count_odd);
+
+		set(v);
+
+		iter_count++;
+	}
+
+	// runs until the value is 1 or below the start value. full iterations are
+	// done while the value cannot drop below the start value during them.
+	void complete_glide() {
+		mp_limb_t start[N_LIMBS];
+		size_t start_used = used;
+		std::copy_n(limbs, used, start);
+
+		size_t start_bitlen = bitlen_of(start, start_used);
+
+		collatz_multistep::with_impact_width(impact_width, [&](auto width) {
+			while (!(used == 1 && limbs[0] == 1) && compare(start, start_used) >= 0) {
+				if (used > N_LIMBS) {
+					hand_off();
+					return;
+				}
+
+				if (bitlen_of(limbs, used) > start_bitlen + LIMB_BITSIZE + 1) {
+					iterate<decltype(width)::value>();
+					continue;
+				}
+
+				// single limb values are stepped in a register until they leave
+				// the limb, reach 1 or drop below start
+				if (used == 1) {
+					dbl_limb_t v = limbs[0];
+
+					while (v >> LIMB_BITSIZE == 0 && v != 1 && v >= start[0]) {
+						collatz_multistep::simple_single_step(v, step_count_odd);
+						step_count_evn++;
+					}
+
+					set(v);
+
+					iter_count++;
+					continue;
+				}
+
+				// (3 * v + 1) / 2 or v / 2
+				if (limbs[0] & 1) {
+					mul_1(3);
+					add(1);
+					step_count_odd++;
+				}
+
+				shift_right_1();
+				step_count_evn++;
+
+				iter_count++;
+			}
+		});
+	}
+
+	// finishes the check of the current value with collatz_checker_slow
+	void hand_off() {
+		collatz_checker_slow slow;
+		slow.impact_width = impact_width;
+		slow.track_max_bitlen = track_max_bitlen;
+
+		mpz_class start = start_value;
+		if (mpz_size(start_value.get_mpz_t()) > N_LIMBS) {
+			slow.value = start_value;
+		} else {
+			mpz_t value;
+			mpz_roinit_n(value, limbs, used);
+			slow.value = mpz_class(value);
+		}
+
+		if (stop_below_start) {
+			slow.complete_glide(start);
+		} else {
+			slow.complete_check();
+		}
+
+		step_count_evn += slow.step_count_evn;
+		step_count_odd += slow.step_count_odd;
+		iter_count += slow.iter_count;
+		max_bitlen = std::max(max_bitlen, slow.max_bitlen);
+
+		handed_off = true;
+
+		// the final value is 1 or below the start value
+		used = std::min(mpz_size(slow.value.get_mpz_t()), N_LIMBS);
+		std::copy_n(mpz_limbs_read(slow.value.get_mpz_t()), used, limbs);
+	}
+
+	inline void set(dbl_limb_t v) {
+		limbs[0] = (mp_limb_t) v;
+		limbs[1] = (mp_limb_t) (v >> LIMB_BITSIZE);
+		used = limbs[1] != 0 ? 2 : 1;
+	}
+
+	// value *= factor
+	inline void mul_1(mp_limb_t factor) {
+		mp_limb_t carry = 0;
+
+		for (size_t i = 0; i < used; i++) {
+			dbl_limb_t product = ((dbl_limb_t) limbs[i]) * factor + carry;
+			limbs[i] = (mp_limb_t) product;
+			carry = (mp_limb_t) (product >> LIMB_BITSIZE);
+		}
+
+		if (carry != 0) {
+			limbs[used++] = carry;
+		}
+	}
+
+	// value += addend
+	inline void add(dbl_limb_t addend) {
+		for (size_t i = 0; addend != 0; i++) {
+			if (i == used) {
+				limbs[used++] = 0;
+			}
+
+			addend += limbs[i];
+			limbs[i] = (mp_limb_t) addend;
+			addend >>= LIMB_BITSIZE;
+		}
+	}
+
+	// value >>= 1
+	inline void shift_right_1() {
+		for (size_t i = 0; i + 1 < used; i++) {
+			limbs[i] = (limbs[i] >> 1) | (limbs[i + 1] << (LIMB_BITSIZE - 1));
+		}
+
+		limbs[used - 1] >>= 1;
+
+		if (used > 1 && limbs[used - 1] == 0) {
+			used--;
+		}
+	}
+
+	// sign of value - other
+	inline int compare(const mp_limb_t *other, size_t other_used) const {
+		if (used != other_used) {
+			return used < other_used ? -1 : 1;
+		}
+
+		for (size_t i = used; i-- > 0;) {
+			if (limbs[i] != other[i]) {
+				return limbs[i] < other[i] ? -1 : 1;
+			}
+		}
+
+		return 0;
+	}
+
+	static inline size_t bitlen_of(const mp_limb_t *l, size_t n) {
+		return n * LIMB_BITSIZE - __builtin_clzll(l[n - 1]);
+	}
+};
+
+#endif /* COLLATZ_CHECKER_FIXED_H_ */
@@ -15,6 +15,16 @@ public:
 	size_t step_count_odd = 0;
 	size_t iter_count = 0;
 
+	// stop as soon as the value drops below the start value, so that the step
+	// counts are those of the glide
+	bool stop_below_start = false;
+
+	void reset() {
+		step_count_evn = 0;
+		step_count_odd = 0;
+		iter_count = 0;
+	}
+
 	mpz_class& start_value_ref() {
 		return value;
 	}
@@ -31,6 +41,8 @@ public:
 	}
 
 	void complete_check() {
+		start = value;
+
 		while (not_finished()) {
 			iterate();
 		}
@@ -44,6 +56,12 @@ public:
 			step_count_odd++;
 		} else {
 			size_t lowest_1_bit_idx = number_of_trailing_zeros(value);
+
+			// the value may drop below start at any of the halvings
+			if (stop_below_start) {
+				lowest_1_bit_idx = 1;
+			}
+
 			value >>= lowest_1_bit_idx;
 
 			step_count_evn += lowest_1_bit_idx;
@@ -53,8 +71,11 @@ public:
 	}
 
 	bool not_finished() {
-		return value != 1;
+		return value != 1 && !(stop_below_start && value < start);
 	}
+
+private:
+	mpz_class start;
 };
 
 #endif /* COLLATZ_CHECKER_NAIVE_H_ */
@@ -3,12 +3,17 @@
 
 #include <gmpxx.h>
 #include <stddef.h>
+#include <algorithm>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <memory>
 
+#include "checker_snapshot.h"
 #include "collatz_multistep.h"
 #include "mpz_utils.h"
+#include "progress_reporter.h"
+#include "stopping_time_memo.h"
 #include "elapsed_time.h"
 namespace ela = elapsed_time;
 
@@ -20,6 +25,35 @@ public:
 	size_t step_count_odd = 0;
 	size_t iter_count = 0;
 
+	// width of the combined impact table used by complete_check()
+	size_t impact_width = collatz_multistep::selected_impact_width;
+
+	// stop as soon as the value drops below the start value, so that the step
+	// counts are those of the glide
+	bool stop_below_start = false;
+
+	// if set, complete_check() keeps the largest bit length of the value after
+	// any iteration in max_bitlen
+	bool track_max_bitlen = false;
+	size_t max_bitlen = 0;
+
+	// if set, complete_check() returns as soon as the value fits into this many
+	// limbs, so that a checker for small values can take over from value
+	size_t handoff_limbs = 0;
+
+	// runs of at least this many trailing ones or zeros are done at once by
+	// complete_check(), see shortcut_run(). 0 disables it.
+	size_t min_run_bits = 2 * LIMB_BITSIZE;
+
+	// if set, complete_check() publishes its progress there, see
+	// progress_counters
+	progress_counters *progress = nullptr;
+
+	// if set, complete_check() writes a snapshot to this file every
+	// snapshot_interval, from which resume() continues. not used in glide mode.
+	std::string snapshot_path;
+	ela::elapsed_time_ns snapshot_interval = 10 * 60 * ela::NS_PER_SEC;
+
 	collatz_checker_slow() {
 	}
 
@@ -27,6 +61,8 @@ public:
 		step_count_evn = 0;
 		step_count_odd = 0;
 		iter_count = 0;
+
+		max_bitlen = 0;
 	}
 
 	inline mpz_class& start_value_ref() {
@@ -36,6 +72,11 @@ public:
 	void start_value_modified() {
 	}
 
+	// sets the start value with a single copy of its limbs
+	void start_value_assign(mpz_srcptr assigned_value) {
+		mpz_set(value.get_mpz_t(), assigned_value);
+	}
+
 	size_t step_count() {
 		return step_count_evn + step_count_odd;
 	}
@@ -45,15 +86,175 @@ public:
 	}
 
 	void complete_check() {
-		while (not_finished()) {
-			iterate();
+		if (stop_below_start) {
+			complete_glide(value);
+			return;
+		}
+
+		std::unique_ptr<checker_snapshot::snapshot_writer> snapshots;
+		if (!snapshot_path.empty()) {
+			snapshots.reset(new checker_snapshot::snapshot_writer(snapshot_path, snapshot_interval));
 		}
+
+		collatz_multistep::with_impact_width(impact_width, [&](auto width) {
+			while (not_finished() && mpz_size(value.get_mpz_t()) > handoff_limbs) {
+				if (track_max_bitlen) {
+					max_bitlen = std::max(max_bitlen, bitlen(value));
+				}
+
+				if (!shortcut_run()) {
+					iterate<decltype(width)::value>();
+				}
+
+				if (progress != nullptr && iter_count % progress_counters::PUBLISH_STRIDE == 0) {
+					publish_progress();
+				}
+
+				if (snapshots && snapshots->due(iter_count)) {
+					snapshots->write([&](checker_snapshot::snapshot_buffer &snapshot) {
+						save(snapshot);
+					});
+				}
+			}
+		});
+
+		if (progress != nullptr) {
+			publish_progress();
+		}
+
+		if (snapshots) {
+			snapshots->finish();
+		}
+	}
+
+	void publish_progress() {
+		progress->publish(step_count_evn, step_count_odd, iter_count, mpz_size(value.get_mpz_t()),
+				mpz_sizeinbase(value.get_mpz_t(), 2));
+	}
+
+	void save(checker_snapshot::snapshot_buffer &snapshot) const {
+		snapshot.put(std::string("slow"));
+		snapshot.put(value);
+		snapshot.put(step_count_evn);
+		snapshot.put(step_count_odd);
+		snapshot.put(iter_count);
+		snapshot.put(impact_width);
+	}
+
+	void load(checker_snapshot::snapshot_buffer &snapshot) {
+		if (snapshot.get_string() != "slow") {
+			throw std::runtime_error("snapshot is not one of collatz_checker_slow");
+		}
+
+		snapshot.get(value);
+		step_count_evn = snapshot.get_u64();
+		step_count_odd = snapshot.get_u64();
+		iter_count = snapshot.get_u64();
+		impact_width = snapshot.get_u64();
+	}
+
+	// loads the snapshot at snapshot_path, so that complete_check() continues
+	// where it was taken. returns false if there is none.
+	bool resume() {
+		checker_snapshot::snapshot_buffer snapshot;
+		if (!checker_snapshot::read(snapshot_path, snapshot)) {
+			return false;
+		}
+
+		load(snapshot);
+		return true;
+	}
+
+	// runs until the value is 1 or below start
+	void complete_glide(const mpz_class &start) {
+		mpz_class start_copy = start;
+		size_t start_bitlen = bitlen(start_copy);
+
+		collatz_multistep::with_impact_width(impact_width, [&](auto width) {
+			while (not_finished() && value >= start_copy) {
+				iterate_above<decltype(width)::value>(start_copy, start_bitlen);
+			}
+		});
+	}
+
+	// does a full iteration if the value cannot drop below start during it,
+	// and single steps otherwise. start_bitlen is bitlen(start).
+	template<size_t IMPACT_WIDTH = collatz_multistep::COMBINED_IMPACT_TABLE_STEP_COUNT>
+	inline void iterate_above(const mpz_class &start, size_t start_bitlen) {
+		// a step at most halves the value
+		if (bitlen(value) > start_bitlen + LIMB_BITSIZE + 1) {
+			iterate<IMPACT_WIDTH>();
+			return;
+		}
+
+		// single limb values are stepped in a register until they leave the
+		// limb, reach 1 or drop below start
+		if (size(value) == 1 && start_bitlen <= LIMB_BITSIZE) {
+			mp_limb_t start_limb = start.get_ui();
+			dbl_limb_t v = value.get_ui();
+
+			while (v >> LIMB_BITSIZE == 0 && v != 1 && v >= start_limb) {
+				collatz_multistep::simple_single_step(v, step_count_odd);
+				step_count_evn++;
+			}
+
+			value = 0;
+			value += v;
+
+			iter_count++;
+			return;
+		}
+
+		collatz_multistep::simple_single_step(value, step_count_odd);
+		step_count_evn++;
+
+		iter_count++;
+	}
+
+	// n = 2^m * k - 1 with odd k becomes 3^m * k - 1 by m steps 3n+1, each
+	// followed by a halving, and n = 2^z * k becomes k by z halvings. does such
+	// a run of at least min_run_bits at the bottom of the value with a single
+	// multiplication or shift and returns whether there was one.
+	bool shortcut_run() {
+		mpz_ptr v = value.get_mpz_t();
+
+		if (min_run_bits == 0) {
+			return false;
+		}
+
+		if (mpz_odd_p(v)) {
+			size_t m = mpz_scan0(v, 0);
+			if (m < min_run_bits) {
+				return false;
+			}
+
+			mpz_add_ui(v, v, 1);
+			mpz_tdiv_q_2exp(v, v, m);
+			power_of_3_big::multiply(value, m);
+			mpz_sub_ui(v, v, 1);
+
+			step_count_evn += m;
+			step_count_odd += m;
+		} else {
+			size_t z = mpz_scan1(v, 0);
+			if (z < min_run_bits) {
+				return false;
+			}
+
+			mpz_tdiv_q_2exp(v, v, z);
+
+			step_count_evn += z;
+		}
+
+		iter_count++;
+		return true;
 	}
 
 	static const uint_fast8_t LIMB_BITSIZE_HALF = sizeof(mp_limb_t) * 8 / 2;
 
 	static const mp_limb_t LIMB_LO_MASK = ~(((mp_limb_t) -1) << LIMB_BITSIZE_HALF);
 
+	template<size_t IMPACT_WIDTH = collatz_multistep::COMBINED_IMPACT_TABLE_STEP_COUNT>
 	inline void iterate() {
 		mp_limb_t lo = value.get_ui();
 		value >>= LIMB_BITSIZE;
@@ -73,7 +274,8 @@ public:
 			// simple_exactly
 
 			exponent = 0;
-			collatz_multistep::combined_impact_exactly<decltype(lo), LIMB_BITSIZE_HALF>(lo, step_count_evn, exponent);
+			collatz_multistep::combined_impact_exactly<decltype(lo), LIMB_BITSIZE_HALF, IMPACT_WIDTH>(lo, step_count_evn,
+					exponent);
 			exponent_cum += exponent;
 
 			pow_of_3 = power_of_3_int::LOOKUP_TABLE<mp_limb_t>[exponent];
@@ -84,7 +286,8 @@ public:
 			hi >>= LIMB_BITSIZE_HALF;
 
 			exponent = 0;
-			collatz_multistep::combined_impact_exactly<decltype(lo), LIMB_BITSIZE_HALF>(lo, step_count_evn, exponent);
+			collatz_multistep::combined_impact_exactly<decltype(lo), LIMB_BITSIZE_HALF, IMPACT_WIDTH>(lo, step_count_evn,
+					exponent);
 			exponent_cum += exponent;
 
 			pow_of_3 = power_of_3_int::LOOKUP_TABLE<mp_limb_t>[exponent];
@@ -93,17 +296,15 @@ public:
 
 			step_count_odd += exponent_cum;
 
-			if (exponent_cum < power_of_3_big::LOOKUP_TABLE_INITIAL_SIZE) {
-				const mpz_class &pow3 = power_of_3_big::LOOKUP_TABLE[exponent_cum];
-				value *= pow3;
-			} else {
-				const mpz_class pow3 = power_of_3_big::calculate(exponent_cum);
-				value *= pow3;
-			}
+			power_of_3_big::multiply(value, exponent_cum);
 
+		} else if (stopping_time_memo::is_enabled() && !track_max_bitlen
+				&& stopping_time_memo::finish(lo, step_count_evn, step_count_odd)) {
+			hi = 1;
 		} else {
 			hi = lo;
-			collatz_multistep::simple_at_most<decltype(hi), LIMB_BITSIZE>(hi, step_count_evn, step_count_odd);
+			collatz_multistep::combined_impact_at_most<decltype(hi), LIMB_BITSIZE, IMPACT_WIDTH>(hi, step_count_evn,
+					step_count_odd);
 		}
 
 		value += hi;
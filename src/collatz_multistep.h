@@ -10,7 +10,13 @@
 #include <cmath>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
 
+#include "elapsed_time.h"
+#include "mpz_utils.h"
 #include "power_of_3_int.h"
 #include "power_of_3_big.h"
 
@@ -84,26 +90,48 @@ inline void simple_at_most(mpz_class &value, size_t &step_count_evn, size_t &ste
 }
 
 // objects of this class are elements of a lookup table for looking up the net
-// impact of the last N bits (typically about 8 or 10) during the next N steps
-// combined.
+// impact of the last N bits (8 to 17) during the next N steps combined. carry,
+// power and exponent are packed into 64 bits, so that a table for N=12 fits
+// into L1 and one for N=16 into L2.
 class multistep_impact {
 public:
-	uint16_t carry;
-	uint16_t power;
-	uint8_t expnt;
+	static const size_t CARRY_BITS = 28;
+	static const size_t POWER_BITS = 28;
+	static const uint64_t FIELD_MASK = (((uint64_t) 1) << CARRY_BITS) - 1;
+
+	uint64_t packed;
+
+	inline uint64_t carry() const {
+		return packed & FIELD_MASK;
+	}
+
+	inline uint64_t power() const {
+		return (packed >> CARRY_BITS) & FIELD_MASK;
+	}
+
+	inline uint64_t expnt() const {
+		return packed >> (CARRY_BITS + POWER_BITS);
+	}
+
+	inline void set(uint64_t carry, uint64_t power, uint64_t expnt) {
+		packed = carry | (power << CARRY_BITS) | (expnt << (CARRY_BITS + POWER_BITS));
+	}
 
 	std::string str() const {
 		std::ostringstream ostr;
 
-		ostr << "multistep_impact[" << carry << " " << power << " " << ((uint64_t) expnt) << "]";
+		ostr << "multistep_impact[" << carry() << " " << power() << " " << expnt() << "]";
 
 		return ostr.str();
 	}
 };
 
 template<size_t STEP_COUNT>
-std::array<multistep_impact, 1 << STEP_COUNT> create_combined_impact_table() {
-	std::array<multistep_impact, 1 << STEP_COUNT> result;
+std::vector<multistep_impact> create_combined_impact_table() {
+	// 3^STEP_COUNT has to fit into the carry and power fields
+	static_assert(STEP_COUNT >= 1 && STEP_COUNT <= 17, "unsupported combined impact table width");
+
+	std::vector<multistep_impact> result(((size_t) 1) << STEP_COUNT);
 
 	const bool LOG = false;
 
@@ -112,24 +140,19 @@ std::array<multistep_impact, 1 << STEP_COUNT> create_combined_impact_table() {
 				<< '\n';
 	}
 
-	typedef decltype(multistep_impact::power) INT_TYPE_POWER;
-	typedef decltype(multistep_impact::carry) INT_TYPE_CARRY;
-
 	for (uint_fast32_t postfix = 0; postfix < result.size(); postfix++) {
 		size_t expnt = 0;
 
-		INT_TYPE_CARRY y = postfix;
+		uint64_t y = postfix;
 		for (size_t i = 0; i < STEP_COUNT; i++) {
 			uint_fast8_t is_odd = ((uint_fast8_t) y) & ((uint_fast8_t) 1);
 			expnt += is_odd;
 			y = (y >> 1) + is_odd * y + is_odd;
 		}
 
-		INT_TYPE_POWER power = power_of_3_int::calculate<INT_TYPE_POWER>(expnt);
+		uint64_t power = power_of_3_int::calculate<uint64_t>(expnt);
 
-		result[postfix].carry = y;
-		result[postfix].expnt = expnt;
-		result[postfix].power = power;
+		result[postfix].set(y, power, expnt);
 
 		if (LOG) {
 			std::cout << postfix << "\t" << std::bitset<STEP_COUNT>(postfix) << "\t" << expnt << "\t" << y << "\t"
@@ -141,30 +164,138 @@ std::array<multistep_impact, 1 << STEP_COUNT> create_combined_impact_table() {
 }
 
 const size_t COMBINED_IMPACT_TABLE_STEP_COUNT = 8;
-const mp_limb_t COMBINED_IMPACT_MASK = ~(((mp_limb_t) -1) << COMBINED_IMPACT_TABLE_STEP_COUNT);
 
-const auto COMBINED_IMPACT_TABLE = create_combined_impact_table<COMBINED_IMPACT_TABLE_STEP_COUNT>();
+template<size_t STEP_COUNT>
+const std::vector<multistep_impact> COMBINED_IMPACT_TABLE = create_combined_impact_table<STEP_COUNT>();
 
-template<typename INT_TYPE, size_t STEP_COUNT>
+// performs STEP_COUNT steps in rounds of TABLE_STEP_COUNT steps, each with one
+// lookup in COMBINED_IMPACT_TABLE<TABLE_STEP_COUNT>. a remainder of less than
+// TABLE_STEP_COUNT steps is done with a narrower table.
+template<typename INT_TYPE, size_t STEP_COUNT, size_t TABLE_STEP_COUNT = COMBINED_IMPACT_TABLE_STEP_COUNT>
 inline void combined_impact_exactly(INT_TYPE &value, size_t &step_count_evn, size_t &step_count_odd) {
-	if ((STEP_COUNT % COMBINED_IMPACT_TABLE_STEP_COUNT) != 0) {
-		throw std::runtime_error("(STEP_COUNT % COMBINED_IMPACT_TABLE_STEP_COUNT) != 0 not supported");
+	const size_t ROUND_COUNT = STEP_COUNT / TABLE_STEP_COUNT;
+	const size_t REMAINDER = STEP_COUNT % TABLE_STEP_COUNT;
+	const mp_limb_t MASK = ~(((mp_limb_t) -1) << TABLE_STEP_COUNT);
+
+	const multistep_impact *table = COMBINED_IMPACT_TABLE<TABLE_STEP_COUNT>.data();
+
+	for (size_t i = 0; i < ROUND_COUNT; i++) {
+		const multistep_impact impact = table[((mp_limb_t) value) & MASK];
+		value >>= TABLE_STEP_COUNT;
+
+		step_count_odd += impact.expnt();
+
+		value *= impact.power();
+
+		value += impact.carry();
 	}
 
-	const size_t COMBINED_STEP_COUNT = STEP_COUNT / COMBINED_IMPACT_TABLE_STEP_COUNT;
+	step_count_evn += ROUND_COUNT * TABLE_STEP_COUNT;
 
-	for (size_t i = 0; i < COMBINED_STEP_COUNT; i++) {
-		uint_fast32_t postfix = value & COMBINED_IMPACT_MASK;
-		value >>= COMBINED_IMPACT_TABLE_STEP_COUNT;
+	if constexpr (REMAINDER != 0) {
+		combined_impact_exactly<INT_TYPE, REMAINDER, REMAINDER>(value, step_count_evn, step_count_odd);
+	}
+}
 
-		step_count_odd += COMBINED_IMPACT_TABLE[postfix].expnt;
+// like simple_at_most(), but does rounds of TABLE_STEP_COUNT steps with one
+// lookup while the value is at least 2^(TABLE_STEP_COUNT + 1), which cannot
+// reach 1 within a round, and single steps otherwise
+template<typename INT_TYPE, size_t STEP_COUNT, size_t TABLE_STEP_COUNT = COMBINED_IMPACT_TABLE_STEP_COUNT>
+inline void combined_impact_at_most(INT_TYPE &value, size_t &step_count_evn, size_t &step_count_odd) {
+	const INT_TYPE ROUND_MIN = ((INT_TYPE) 1) << (TABLE_STEP_COUNT + 1);
 
-		value *= COMBINED_IMPACT_TABLE[postfix].power;
+	size_t i = 0;
 
-		value += COMBINED_IMPACT_TABLE[postfix].carry;
+	while (i < STEP_COUNT && value != 1) {
+		if (i + TABLE_STEP_COUNT <= STEP_COUNT && value >= ROUND_MIN) {
+			combined_impact_exactly<INT_TYPE, TABLE_STEP_COUNT, TABLE_STEP_COUNT>(value, step_count_evn,
+					step_count_odd);
+			i += TABLE_STEP_COUNT;
+		} else {
+			simple_single_step<INT_TYPE>(value, step_count_odd);
+			step_count_evn++;
+			i++;
+		}
 	}
+}
 
-	step_count_evn += STEP_COUNT;
+// table widths which can be selected at runtime
+const size_t IMPACT_WIDTH_LIST[] = { 8, 11, 12, 16 };
+
+// table width used by newly created checkers
+inline size_t selected_impact_width = COMBINED_IMPACT_TABLE_STEP_COUNT;
+
+// calls func with std::integral_constant<size_t, width>, so that func can pass
+// width on as a template argument
+template<typename FUNC>
+inline void with_impact_width(size_t width, FUNC &&func) {
+	switch (width) {
+	case 8:
+		func(std::integral_constant<size_t, 8>());
+		break;
+	case 11:
+		func(std::integral_constant<size_t, 11>());
+		break;
+	case 12:
+		func(std::integral_constant<size_t, 12>());
+		break;
+	case 16:
+		func(std::integral_constant<size_t, 16>());
+		break;
+	default:
+		std::ostringstream os;
+		os << "unsupported combined impact table width " << width;
+		throw std::runtime_error(os.str());
+	}
+}
+
+// times 64 step rounds of combined_impact_exactly for every width in
+// IMPACT_WIDTH_LIST on pseudo random limbs and returns the fastest width.
+inline size_t calibrate_impact_width(size_t limb_count = 1 << 16, std::ostream *log = nullptr) {
+	std::vector<mp_limb_t> limbs = random_limbs(limb_count, 0);
+
+	size_t best_width = COMBINED_IMPACT_TABLE_STEP_COUNT;
+	elapsed_time::elapsed_time_ns best_time = std::numeric_limits<elapsed_time::elapsed_time_ns>::max();
+
+	for (size_t width : IMPACT_WIDTH_LIST) {
+		elapsed_time::elapsed_time_ns min_time = std::numeric_limits<elapsed_time::elapsed_time_ns>::max();
+
+		for (size_t rep = 0; rep < 3; rep++) {
+			volatile mp_limb_t sink = 0;
+			size_t step_count_evn = 0;
+			size_t step_count_odd = 0;
+
+			elapsed_time::elapsed_time_ns t = elapsed_time::steady_time();
+
+			with_impact_width(width, [&](auto w) {
+				mp_limb_t acc = 0;
+
+				for (mp_limb_t limb : limbs) {
+					dbl_limb_t value = limb;
+					combined_impact_exactly<dbl_limb_t, LIMB_BITSIZE, decltype(w)::value>(value, step_count_evn,
+							step_count_odd);
+					acc ^= (mp_limb_t) value;
+				}
+
+				sink = acc;
+			});
+
+			t = elapsed_time::steady_time() - t;
+
+			min_time = std::min(min_time, t);
+		}
+
+		if (log != nullptr) {
+			*log << "impact width " << width << ": " << elapsed_time::format_dura(min_time) << '\n';
+		}
+
+		if (min_time < best_time) {
+			best_time = min_time;
+			best_width = width;
+		}
+	}
+
+	return best_width;
 }
 
 }
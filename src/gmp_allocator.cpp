@@ -0,0 +1,452 @@
+#include "gmp_allocator.h"
+
+#include <gmp.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using std::string;
+
+namespace gmp_allocator {
+
+static const size_t MIN_CLASS_BYTES = 16;
+static const size_t MIN_CLASS_LOG = 4;
+static const size_t CLASS_COUNT = 13;
+
+// the pools carve their blocks out of chunks, which are never returned
+static const size_t CHUNK_BYTES = 1 << 20;
+
+static const size_t HUGE_PAGE_BYTES = 1 << 21;
+
+static config current_config;
+static bool installed = false;
+
+void configure(const config &c) {
+	if (installed) {
+		throw std::runtime_error("the gmp allocator cannot be configured once installed");
+	}
+
+	if (c.pool_max_bytes != 0
+			&& (c.pool_max_bytes < MIN_CLASS_BYTES || c.pool_max_bytes > MAX_POOL_BYTES
+					|| (c.pool_max_bytes & (c.pool_max_bytes - 1)) != 0)) {
+		throw std::runtime_error("the pool size classes end at a power of 2 from 16 to 65536 bytes");
+	}
+
+	if (c.huge_pages != huge_page_mode::off && c.huge_page_min_bytes <= c.pool_max_bytes) {
+		throw std::runtime_error("huge page blocks have to be bigger than the pooled ones");
+	}
+
+	current_config = c;
+}
+
+const config& get_config() {
+	return current_config;
+}
+
+// like the default functions of gmp, which cannot recover either
+[[noreturn]] static void out_of_memory(size_t size) {
+	std::fprintf(stderr, "gmp_allocator: cannot allocate %zu bytes\n", size);
+	std::abort();
+}
+
+// written only by the owning thread, read by get_statistics()
+struct counters {
+	std::atomic<uint64_t> allocations { 0 };
+	std::atomic<uint64_t> reallocations { 0 };
+	std::atomic<uint64_t> frees { 0 };
+	std::atomic<uint64_t> bytes { 0 };
+	std::atomic<uint64_t> pool_hits { 0 };
+	std::atomic<uint64_t> mappings { 0 };
+};
+
+static inline void bump(std::atomic<uint64_t> &counter, uint64_t amount = 1) {
+	counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+static void add_to(statistics &s, const counters &c) {
+	s.allocations += c.allocations.load(std::memory_order_relaxed);
+	s.reallocations += c.reallocations.load(std::memory_order_relaxed);
+	s.frees += c.frees.load(std::memory_order_relaxed);
+	s.bytes += c.bytes.load(std::memory_order_relaxed);
+	s.pool_hits += c.pool_hits.load(std::memory_order_relaxed);
+	s.mappings += c.mappings.load(std::memory_order_relaxed);
+}
+
+// constant initialized and trivially destructible, so that it stays usable
+// while the other thread locals are destroyed
+struct thread_state {
+	void *free_lists[CLASS_COUNT] = { };
+
+	char *chunk = nullptr;
+	size_t chunk_left = 0;
+
+	counters counts;
+
+	// of allocations while the thread ends, which are not counted
+	counters uncounted;
+
+	bool registered = false;
+
+	// the free lists went to the shared ones at the end of the thread
+	bool retired = false;
+};
+
+static thread_local thread_state state;
+
+// the free lists of finished threads and the counters of all threads. never
+// destroyed, as gmp may free blocks in static destructors.
+struct shared_state {
+	std::mutex mutex;
+
+	void *free_lists[CLASS_COUNT] = { };
+
+	std::vector<const counters*> live;
+	counters retired;
+};
+
+static shared_state& shared() {
+	static shared_state *s = new shared_state();
+	return *s;
+}
+
+static inline void push(void *&list, void *p) {
+	*static_cast<void**>(p) = list;
+	list = p;
+}
+
+static inline void* pop(void *&list) {
+	void *p = list;
+	list = *static_cast<void**>(p);
+	return p;
+}
+
+// hands the free lists and counters of the thread over when it ends
+struct thread_retirement {
+	~thread_retirement() {
+		shared_state &s = shared();
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		for (size_t c = 0; c < CLASS_COUNT; c++) {
+			while (state.free_lists[c] != nullptr) {
+				push(s.free_lists[c], pop(state.free_lists[c]));
+			}
+		}
+
+		statistics total;
+		add_to(total, state.counts);
+
+		bump(s.retired.allocations, total.allocations);
+		bump(s.retired.reallocations, total.reallocations);
+		bump(s.retired.frees, total.frees);
+		bump(s.retired.bytes, total.bytes);
+		bump(s.retired.pool_hits, total.pool_hits);
+		bump(s.retired.mappings, total.mappings);
+
+		for (auto it = s.live.begin(); it != s.live.end(); ++it) {
+			if (*it == &state.counts) {
+				s.live.erase(it);
+				break;
+			}
+		}
+
+		state.retired = true;
+	}
+};
+
+static counters& thread_counters() {
+	if (!state.registered) {
+		state.registered = true;
+
+		static thread_local thread_retirement retirement;
+		(void) retirement;
+
+		shared_state &s = shared();
+		std::lock_guard<std::mutex> lock(s.mutex);
+		s.live.push_back(&state.counts);
+	}
+
+	return state.retired ? state.uncounted : state.counts;
+}
+
+static inline bool is_pooled(size_t size) {
+	return size <= current_config.pool_max_bytes;
+}
+
+static inline bool is_mapped(size_t size) {
+	return current_config.huge_pages != huge_page_mode::off && size >= current_config.huge_page_min_bytes;
+}
+
+static inline size_t size_class(size_t size) {
+	if (size <= MIN_CLASS_BYTES) {
+		return 0;
+	}
+
+	return (64 - __builtin_clzll(size - 1)) - MIN_CLASS_LOG;
+}
+
+static inline size_t class_bytes(size_t c) {
+	return MIN_CLASS_BYTES << c;
+}
+
+static void* pool_allocate(size_t size, counters &counts) {
+	size_t c = size_class(size);
+	size_t bytes = class_bytes(c);
+
+	if (state.retired) {
+		// a block of its own, which joins the shared lists when freed
+		shared_state &s = shared();
+		std::lock_guard<std::mutex> lock(s.mutex);
+
+		if (s.free_lists[c] != nullptr) {
+			return pop(s.free_lists[c]);
+		}
+
+		void *p = std::malloc(bytes);
+		if (p == nullptr) {
+			out_of_memory(bytes);
+		}
+
+		return p;
+	}
+
+	if (state.free_lists[c] != nullptr) {
+		bump(counts.pool_hits);
+		return pop(state.free_lists[c]);
+	}
+
+	if (state.chunk_left < bytes) {
+		// the rest of the old chunk is left unused
+		state.chunk = static_cast<char*>(std::malloc(CHUNK_BYTES));
+		if (state.chunk == nullptr) {
+			out_of_memory(CHUNK_BYTES);
+		}
+
+		state.chunk_left = CHUNK_BYTES;
+	}
+
+	void *p = state.chunk;
+	state.chunk += bytes;
+	state.chunk_left -= bytes;
+
+	return p;
+}
+
+static void pool_deallocate(void *p, size_t size) {
+	size_t c = size_class(size);
+
+	if (state.retired) {
+		shared_state &s = shared();
+		std::lock_guard<std::mutex> lock(s.mutex);
+		push(s.free_lists[c], p);
+		return;
+	}
+
+	push(state.free_lists[c], p);
+}
+
+static inline size_t mapped_bytes(size_t size) {
+	return (size + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+}
+
+static void* map_allocate(size_t size, counters &counts) {
+	size_t bytes = mapped_bytes(size);
+	void *p = MAP_FAILED;
+
+	if (current_config.huge_pages == huge_page_mode::explicit_pages) {
+		p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+
+	if (p == MAP_FAILED) {
+		p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			out_of_memory(bytes);
+		}
+
+		// only a hint, which fails without transparent huge pages
+		madvise(p, bytes, MADV_HUGEPAGE);
+	}
+
+	bump(counts.mappings);
+
+	return p;
+}
+
+static void map_deallocate(void *p, size_t size) {
+	munmap(p, mapped_bytes(size));
+}
+
+void* allocate(size_t size) {
+	counters &counts = thread_counters();
+	bump(counts.allocations);
+	bump(counts.bytes, size);
+
+	if (is_pooled(size)) {
+		return pool_allocate(size, counts);
+	}
+
+	if (is_mapped(size)) {
+		return map_allocate(size, counts);
+	}
+
+	void *p = std::malloc(size);
+	if (p == nullptr) {
+		out_of_memory(size);
+	}
+
+	return p;
+}
+
+void* reallocate(void *p, size_t old_size, size_t new_size) {
+	counters &counts = thread_counters();
+	bump(counts.reallocations);
+
+	if (new_size > old_size) {
+		bump(counts.bytes, new_size - old_size);
+	}
+
+	bool old_pooled = is_pooled(old_size);
+	bool new_pooled = is_pooled(new_size);
+
+	if (old_pooled && new_pooled && size_class(old_size) == size_class(new_size)) {
+		bump(counts.pool_hits);
+		return p;
+	}
+
+	bool old_mapped = is_mapped(old_size);
+	bool new_mapped = is_mapped(new_size);
+
+	if (old_mapped && new_mapped) {
+		if (mapped_bytes(old_size) == mapped_bytes(new_size)) {
+			return p;
+		}
+
+		// fails for explicit huge pages on older kernels, which are copied
+		void *q = mremap(p, mapped_bytes(old_size), mapped_bytes(new_size), MREMAP_MAYMOVE);
+		if (q != MAP_FAILED) {
+			bump(counts.mappings);
+			return q;
+		}
+	}
+
+	if (!old_pooled && !old_mapped && !new_pooled && !new_mapped) {
+		void *q = std::realloc(p, new_size);
+		if (q == nullptr) {
+			out_of_memory(new_size);
+		}
+
+		return q;
+	}
+
+	void *q;
+	if (new_pooled) {
+		q = pool_allocate(new_size, counts);
+	} else if (new_mapped) {
+		q = map_allocate(new_size, counts);
+	} else {
+		q = std::malloc(new_size);
+		if (q == nullptr) {
+			out_of_memory(new_size);
+		}
+	}
+
+	std::memcpy(q, p, std::min(old_size, new_size));
+
+	if (old_pooled) {
+		pool_deallocate(p, old_size);
+	} else if (old_mapped) {
+		map_deallocate(p, old_size);
+	} else {
+		std::free(p);
+	}
+
+	return q;
+}
+
+void deallocate(void *p, size_t size) {
+	if (p == nullptr) {
+		return;
+	}
+
+	bump(thread_counters().frees);
+
+	if (is_pooled(size)) {
+		pool_deallocate(p, size);
+	} else if (is_mapped(size)) {
+		map_deallocate(p, size);
+	} else {
+		std::free(p);
+	}
+}
+
+void install() {
+	if (installed) {
+		return;
+	}
+
+	mp_set_memory_functions(allocate, reallocate, deallocate);
+	installed = true;
+}
+
+bool is_installed() {
+	return installed;
+}
+
+statistics statistics::operator-(const statistics &earlier) const {
+	statistics d = *this;
+
+	d.allocations -= earlier.allocations;
+	d.reallocations -= earlier.reallocations;
+	d.frees -= earlier.frees;
+	d.bytes -= earlier.bytes;
+	d.pool_hits -= earlier.pool_hits;
+	d.mappings -= earlier.mappings;
+
+	return d;
+}
+
+string statistics::str() const {
+	std::ostringstream os;
+
+	os << "gmp_alloc[" //
+			<< "allocations=" << allocations //
+			<< " reallocations=" << reallocations //
+			<< " frees=" << frees //
+			<< " bytes=" << bytes //
+			<< " pool_hits=" << pool_hits //
+			<< " mappings=" << mappings //
+			<< " peak_rss=" << peak_rss_bytes //
+			<< "]";
+
+	return os.str();
+}
+
+statistics get_statistics() {
+	statistics s;
+
+	{
+		shared_state &shared_s = shared();
+		std::lock_guard<std::mutex> lock(shared_s.mutex);
+
+		add_to(s, shared_s.retired);
+		for (const counters *c : shared_s.live) {
+			add_to(s, *c);
+		}
+	}
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		s.peak_rss_bytes = (size_t) usage.ru_maxrss * 1024;
+	}
+
+	return s;
+}
+
+} /* namespace gmp_allocator */
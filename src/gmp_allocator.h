@@ -0,0 +1,91 @@
+#ifndef GMP_ALLOCATOR_H_
+#define GMP_ALLOCATOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// the memory functions of gmp, installed with mp_set_memory_functions().
+//
+// the checkers create and drop temporaries all the time, e.g. the pulled
+// values and powers of 3 of the accu_chain, which go through malloc() and
+// realloc(). small blocks come from size class pools per thread instead, in
+// which a realloc() within the class keeps the block. blocks of at least
+// huge_page_min_bytes, the big products and the scratch space of mpn_mul(),
+// are mapped directly and backed by huge pages.
+//
+// both stay on the numa node of the thread that uses them first, as the
+// pools are per thread and the kernel places pages on first touch.
+//
+// gmp passes the size of a block to realloc() and free(), which picks the
+// pool, mapping or malloc() the block came from. all blocks thus have to be
+// allocated after install(), which has to be called before any gmp
+// allocation and cannot be undone.
+namespace gmp_allocator {
+
+enum class huge_page_mode {
+	// big blocks come from malloc() like the rest
+	off,
+	// mmap() with madvise(MADV_HUGEPAGE)
+	transparent,
+	// mmap() with MAP_HUGETLB from the reserved pool, falling back to
+	// transparent when it is exhausted
+	explicit_pages
+};
+
+struct config {
+	// the size classes are the powers of 2 from 16 up to this, 0 for no pools
+	size_t pool_max_bytes = 1 << 12;
+
+	huge_page_mode huge_pages = huge_page_mode::transparent;
+
+	size_t huge_page_min_bytes = ((size_t) 1) << 22;
+};
+
+const size_t MAX_POOL_BYTES = 1 << 16;
+
+// not thread safe and only before install()
+void configure(const config &c);
+
+const config& get_config();
+
+// installs the functions below for gmp, not thread safe
+void install();
+
+bool is_installed();
+
+void* allocate(size_t size);
+
+void* reallocate(void *p, size_t old_size, size_t new_size);
+
+void deallocate(void *p, size_t size);
+
+struct statistics {
+	uint64_t allocations = 0;
+	uint64_t reallocations = 0;
+	uint64_t frees = 0;
+
+	// by allocations and growing reallocations
+	uint64_t bytes = 0;
+
+	// allocations served from a free list, reallocations kept in place
+	uint64_t pool_hits = 0;
+
+	// big blocks mapped, also by reallocations
+	uint64_t mappings = 0;
+
+	// of the process so far, not a difference
+	size_t peak_rss_bytes = 0;
+
+	// the counters since an earlier snapshot
+	statistics operator-(const statistics &earlier) const;
+
+	std::string str() const;
+};
+
+// summed over all threads, including finished ones
+statistics get_statistics();
+
+} /* namespace gmp_allocator */
+
+#endif /* GMP_ALLOCATOR_H_ */
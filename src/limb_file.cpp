@@ -0,0 +1,58 @@
+#include "limb_file.h"
+
+#include <fstream>
+#include <stdexcept>
+
+using std::string;
+
+void write_limb_file(const string &path, mpz_srcptr value) {
+	if (mpz_sgn(value) < 0) {
+		throw std::runtime_error("limb files cannot hold negative values");
+	}
+
+	std::ofstream out = table_file::create(path, LIMB_FILE_KIND);
+
+	table_file::header header = table_file::make_header(LIMB_FILE_MAGIC, LIMB_FILE_VERSION, sizeof(mp_limb_t),
+			mpz_size(value));
+
+	table_file::write_header(out, header);
+	out.seekp(header.data_offset);
+	out.write(reinterpret_cast<const char*>(mpz_limbs_read(value)), header.entry_count * sizeof(mp_limb_t));
+
+	table_file::finish(out, path);
+}
+
+void write_limb_stream_magic(std::ostream &out) {
+	if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) {
+		throw std::runtime_error("limb streams are only supported on little-endian hosts");
+	}
+
+	out.write(LIMB_STREAM_MAGIC, sizeof(LIMB_STREAM_MAGIC));
+}
+
+void write_limb_record(std::ostream &out, mpz_srcptr value) {
+	uint64_t limb_count = mpz_size(value);
+
+	out.write(reinterpret_cast<const char*>(&limb_count), sizeof(limb_count));
+	out.write(reinterpret_cast<const char*>(mpz_limbs_read(value)), limb_count * sizeof(mp_limb_t));
+}
+
+void limb_file::open(const string &path) {
+	file.open(path);
+
+	table_file::header header = table_file::read_header(file, LIMB_FILE_MAGIC, LIMB_FILE_VERSION, LIMB_FILE_KIND);
+
+	if (header.param != sizeof(mp_limb_t)) {
+		table_file::unsupported(file, LIMB_FILE_KIND, "limb_size=" + std::to_string(header.param));
+	}
+
+	table_file::ensure_data(file, header, header.entry_count, sizeof(mp_limb_t), LIMB_FILE_KIND);
+
+	limbs = reinterpret_cast<const mp_limb_t*>(file.begin() + header.data_offset);
+	limb_count = header.entry_count;
+
+	// mpz_roinit_n() drops high zero limbs, but they would still be copied
+	while (limb_count > 0 && limbs[limb_count - 1] == 0) {
+		limb_count--;
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef LIMB_FILE_H_
+#define LIMB_FILE_H_
+
+#include <gmp.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <ostream>
+#include <string>
+
+#include "mapped_file.h"
+#include "table_file.h"
+
+// a start value stored as its raw limbs, so that huge values never go through
+// decimal text and can be loaded by a single copy of the limbs.
+//
+// layout: a table_file::header with the limb size as param and the limb
+// count as entry_count, then the little-endian limbs from the least to the
+// most significant, starting at data_offset.
+const char LIMB_FILE_MAGIC[8] = { 'C', 'O', 'L', 'L', 'I', 'M', 'B', '\0' };
+const uint32_t LIMB_FILE_VERSION = 1;
+const char LIMB_FILE_KIND[] = "limb";
+
+void write_limb_file(const std::string &path, mpz_srcptr value);
+
+// a stream of values, e.g. for the stream command: LIMB_STREAM_MAGIC, then
+// for each value its limb count as uint64_t and its little-endian limbs
+const char LIMB_STREAM_MAGIC[8] = { 'C', 'O', 'L', 'L', 'S', 'T', 'R', '\0' };
+
+void write_limb_stream_magic(std::ostream &out);
+
+void write_limb_record(std::ostream &out, mpz_srcptr value);
+
+// a mapped limb file
+class limb_file {
+public:
+	limb_file() {
+	}
+
+	explicit limb_file(const std::string &path) {
+		open(path);
+	}
+
+	void open(const std::string &path);
+
+	size_t size() const {
+		return limb_count;
+	}
+
+	const mp_limb_t* data() const {
+		return limbs;
+	}
+
+	// points view to the mapped limbs without copying them. view is read-only
+	// and must not be cleared.
+	void view(mpz_t view) const {
+		mpz_roinit_n(view, limbs, limb_count);
+	}
+
+private:
+	mapped_file file;
+	const mp_limb_t *limbs = nullptr;
+	size_t limb_count = 0;
+};
+
+#endif /* LIMB_FILE_H_ */
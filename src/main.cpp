@@ -1,14 +1,38 @@
 #include <gmp.h>
 #include <gmpxx.h>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include "chain_geometry.h"
+#include "checker_dispatch.h"
+#include "collatz_batch.h"
 #include "collatz_checker_fast.h"
 #include "collatz_checker_slow.h"
 #include "collatz_checker_naive.h"
+#include "collatz_checker_dc.h"
+#include "collatz_checker_fixed.h"
 #include "elapsed_time.h"
 #include "amount_formatter.h"
+#include "gmp_allocator.h"
+#include "limb_file.h"
+#include "neighborhood_sweep.h"
+#include "parallel_mul.h"
+#include "progress_reporter.h"
+#include "range_verifier.h"
+#include "regression_suite.h"
+#include "stopping_time_memo.h"
+#include "stream_checker.h"
+#include "residue_sieve.h"
 
 using std::cout;
 using std::flush;
@@ -45,7 +69,7 @@ void test_single(const mpz_class &n, uint64_t step_count_evn_expected, uint64_t
 	ensure_matching(checker.step_count_evn, step_count_evn_expected, checker.step_count_odd, step_count_odd_expected);
 }
 
-void test_3_algorithms_consistency() {
+void test_algorithms_consistency() {
 	struct test_case {
 		mpz_class n;
 		uint64_t step_count_evn;
@@ -74,12 +98,501 @@ void test_3_algorithms_consistency() {
 					"7457634543564564356543765868989546221123264476548153453452351432452366890718900767686634213422312124468578453411236799872211651",
 					2013, 1004));
 
-	for (size_t i = 0; i < test_case_list.size(); i++) {
-		const auto &test_case = test_case_list[i];
+	size_t selected_impact_width = collatz_multistep::selected_impact_width;
 
-		test_single<collatz_checker_naive>(test_case.n, test_case.step_count_evn, test_case.step_count_odd);
-		test_single<collatz_checker_slow>(test_case.n, test_case.step_count_evn, test_case.step_count_odd);
-		test_single<collatz_checker_fast>(test_case.n, test_case.step_count_evn, test_case.step_count_odd);
+	for (size_t impact_width : collatz_multistep::IMPACT_WIDTH_LIST) {
+		collatz_multistep::selected_impact_width = impact_width;
+
+		for (size_t i = 0; i < test_case_list.size(); i++) {
+			const auto &test_case = test_case_list[i];
+
+			test_single<collatz_checker_naive>(test_case.n, test_case.step_count_evn, test_case.step_count_odd);
+			test_single<collatz_checker_slow>(test_case.n, test_case.step_count_evn, test_case.step_count_odd);
+			test_single<collatz_checker_fast>(test_case.n, test_case.step_count_evn, test_case.step_count_odd);
+			test_single<collatz_checker_dc>(test_case.n, test_case.step_count_evn, test_case.step_count_odd);
+			test_single<collatz_checker_fixed<2>>(test_case.n, test_case.step_count_evn, test_case.step_count_odd);
+			test_single<collatz_checker_fixed<8>>(test_case.n, test_case.step_count_evn, test_case.step_count_odd);
+		}
+	}
+
+	collatz_multistep::selected_impact_width = selected_impact_width;
+}
+
+void test_large_number_consistency() {
+	mpz_class start_value = 1;
+	start_value <<= 100000;
+	start_value++;
+
+	test_single<collatz_checker_slow>(start_value, 478838, 239020);
+	test_single<collatz_checker_fast>(start_value, 478838, 239020);
+	test_single<collatz_checker_dc>(start_value, 478838, 239020);
+}
+
+template<typename CHECKER>
+void test_glide(const mpz_class &n, uint64_t step_count_evn_expected, uint64_t step_count_odd_expected) {
+	CHECKER checker;
+	checker.stop_below_start = true;
+	checker.start_value_ref() = n;
+	checker.start_value_modified();
+
+	checker.complete_check();
+
+	ensure_matching(checker.step_count_evn, step_count_evn_expected, checker.step_count_odd, step_count_odd_expected);
+}
+
+void test_glide_consistency() {
+	mpz_class start_value;
+
+	// 27 has a glide of 96 steps
+	start_value = 27;
+	test_glide<collatz_checker_naive>(start_value, 59, 37);
+	test_glide<collatz_checker_slow>(start_value, 59, 37);
+	test_glide<collatz_checker_fast>(start_value, 59, 37);
+	test_glide<collatz_checker_dc>(start_value, 59, 37);
+	test_glide<collatz_checker_fixed<4>>(start_value, 59, 37);
+
+	// 2^k - 1 rises for k steps, so its glide is long
+	start_value = 1;
+	start_value <<= 100000;
+	start_value--;
+
+	test_glide<collatz_checker_slow>(start_value, 384048, 242307);
+	test_glide<collatz_checker_fast>(start_value, 384048, 242307);
+	test_glide<collatz_checker_dc>(start_value, 384048, 242307);
+	test_glide<collatz_checker_fixed<4>>(start_value, 384048, 242307);
+}
+
+// resumes from the last snapshot taken during a check, which has to give the
+// same step counts as the check itself
+template<typename CHECKER>
+void test_snapshot_resume(const mpz_class &n, uint64_t step_count_evn_expected, uint64_t step_count_odd_expected) {
+	std::string path = (std::filesystem::temp_directory_path() / "collatz_huge_fast_test.snapshot").string();
+	std::filesystem::remove(path);
+
+	CHECKER checker;
+	checker.snapshot_path = path;
+	checker.snapshot_interval = 0;
+	checker.start_value_ref() = n;
+	checker.start_value_modified();
+
+	checker.complete_check();
+
+	ensure_matching(checker.step_count_evn, step_count_evn_expected, checker.step_count_odd, step_count_odd_expected);
+
+	CHECKER resumed;
+	resumed.snapshot_path = path;
+
+	if (!resumed.resume() || resumed.iter_count == 0 || resumed.iter_count >= checker.iter_count) {
+		throw std::runtime_error("no snapshot taken during the check of " + checker.type_abbrev());
+	}
+
+	resumed.complete_check();
+
+	ensure_matching(resumed.step_count_evn, step_count_evn_expected, resumed.step_count_odd, step_count_odd_expected);
+	ensure_matching(resumed.iter_count, checker.iter_count, 0, 0);
+
+	std::filesystem::remove(path);
+}
+
+void test_snapshot_consistency() {
+	mpz_class start_value = 1;
+	start_value <<= 100000;
+	start_value++;
+
+	test_snapshot_resume<collatz_checker_slow>(start_value, 478838, 239020);
+	test_snapshot_resume<collatz_checker_fast>(start_value, 478838, 239020);
+}
+
+// the geometry of the chain changes the work, but not the step counts
+void test_chain_geometry() {
+	chain_geometry g;
+	g.min_pull_limbs = 4;
+	g.growth = 3;
+	g.push_ratio = 1.7;
+	g.exp_of_3_ratio = 0.5;
+
+	mpz_class start_value = 1;
+	start_value <<= 100000;
+	start_value++;
+
+	collatz_checker_fast checker;
+	checker.chain.set_geometry(g);
+	checker.start_value_assign(start_value.get_mpz_t());
+	checker.complete_check();
+
+	ensure_matching(checker.step_count_evn, 478838, checker.step_count_odd, 239020);
+}
+
+// products of parallel_mul against mpn_mul, from thin slices to square
+// pieces, and with all limbs set for long carries between the blocks
+void test_parallel_mul() {
+	parallel_mul::config saved = parallel_mul::get_config();
+
+	parallel_mul::config c;
+	c.thread_count = 4;
+	c.cutover_limbs = 4;
+	c.min_piece_limbs = 2;
+	parallel_mul::configure(c);
+
+	size_t sizes[][2] = { { 64, 64 }, { 257, 256 }, { 100, 37 }, { 1000, 10 }, { 5, 4 }, { 3, 3 } };
+
+	for (bool all_ones : { false, true }) {
+		for (auto &size : sizes) {
+			size_t an = size[0];
+			size_t bn = size[1];
+
+			vector<mp_limb_t> a = random_limbs(an, an);
+			vector<mp_limb_t> b = random_limbs(bn, bn);
+			if (all_ones) {
+				std::fill(a.begin(), a.end(), ~(mp_limb_t) 0);
+				std::fill(b.begin(), b.end(), ~(mp_limb_t) 0);
+			}
+
+			vector<mp_limb_t> expected(an + bn);
+			vector<mp_limb_t> product(an + bn);
+			mpn_mul(expected.data(), a.data(), an, b.data(), bn);
+			parallel_mul::mul(product.data(), a.data(), an, b.data(), bn);
+
+			if (product != expected) {
+				parallel_mul::configure(saved);
+				throw std::runtime_error(
+						"wrong parallel_mul product of " + std::to_string(an) + " by " + std::to_string(bn) + " limbs");
+			}
+		}
+	}
+
+	parallel_mul::configure(saved);
+}
+
+// small crossovers, so that a value is handed down through all checkers
+void test_dispatch_handoff() {
+	checker_dispatch::profile p;
+	p.fixed_max_limbs = 2;
+	p.slow_max_limbs = 16;
+
+	mpz_class start_value = 1;
+	start_value <<= 100000;
+	start_value++;
+
+	checker_dispatch::result r;
+	checker_dispatch::check(start_value.get_mpz_t(), r, false, p);
+
+	ensure_matching(r.step_count_evn, 478838, r.step_count_odd, 239020);
+
+	if (r.checkers != "fast>slow>fixed256") {
+		throw std::runtime_error("unexpected dispatch " + r.checkers);
+	}
+
+	// crossovers of a few limbs, which fast often goes below between two
+	// handoff checks and then finishes on its own
+	start_value = 1;
+	start_value <<= 2000;
+	start_value++;
+
+	for (size_t slow_max_limbs = 1; slow_max_limbs <= 4; slow_max_limbs++) {
+		p.fixed_max_limbs = 1;
+		p.slow_max_limbs = slow_max_limbs;
+
+		checker_dispatch::check(start_value.get_mpz_t(), r, false, p);
+
+		ensure_matching(r.step_count_evn, 10120, r.step_count_odd, 5123);
+	}
+
+	// fast hands off once the lower bound of the bit length fits into
+	// handoff_limbs, and slow finishes from the materialized value. the value
+	// itself may be a little longer than the bound.
+	collatz_checker_fast fast;
+	fast.handoff_limbs = 4;
+	fast.start_value_assign(start_value.get_mpz_t());
+	fast.complete_check();
+
+	if (!fast.handed_off) {
+		throw std::runtime_error("fast did not hand off");
+	}
+
+	size_t bound = fast.chain.bitlen_lower_bound();
+	if (bound > 4 * LIMB_BITSIZE) {
+		throw std::runtime_error("fast handed off above a bit length bound of 4 limbs");
+	}
+
+	collatz_checker_slow slow;
+	fast.chain.materialize(slow.start_value_ref());
+	slow.start_value_modified();
+
+	if (mpz_sizeinbase(slow.start_value_ref().get_mpz_t(), 2) < bound) {
+		throw std::runtime_error("fast handed off a value below its bit length bound");
+	}
+
+	slow.complete_check();
+
+	ensure_matching(fast.step_count_evn + slow.step_count_evn, 10120, fast.step_count_odd + slow.step_count_odd,
+			5123);
+}
+
+// runs of ones and zeros at the bottom, done at once and step by step
+void test_run_shortcuts() {
+	mpz_class start_value = 1;
+	start_value <<= 10000;
+	start_value--;
+	start_value <<= 1000;
+
+	for (int i = 0; i < 2; i++) {
+		collatz_checker_slow slow;
+		slow.start_value_ref() = start_value;
+		slow.complete_check();
+
+		collatz_checker_fast fast;
+		fast.start_value_assign(start_value.get_mpz_t());
+		fast.complete_check();
+
+		collatz_checker_fast fast_stepped;
+		fast_stepped.min_run_limbs = 0;
+		fast_stepped.start_value_assign(start_value.get_mpz_t());
+		fast_stepped.complete_check();
+
+		ensure_matching(slow.step_count_evn, fast_stepped.step_count_evn, slow.step_count_odd,
+				fast_stepped.step_count_odd);
+		ensure_matching(fast.step_count_evn, fast_stepped.step_count_evn, fast.step_count_odd,
+				fast_stepped.step_count_odd);
+
+		start_value >>= 1000;
+	}
+
+	// a run of zeros down to a few limbs still hands the value down
+	checker_dispatch::profile p;
+	p.fixed_max_limbs = 2;
+	p.slow_max_limbs = 16;
+
+	start_value = 1;
+	start_value <<= 3000;
+
+	checker_dispatch::result r;
+	checker_dispatch::check(start_value.get_mpz_t(), r, false, p);
+
+	ensure_matching(r.step_count_evn, 3000, r.step_count_odd, 0);
+}
+
+// a neighborhood against checks of its members one by one
+void test_neighborhood_sweep() {
+	mpz_class base = 1;
+	base <<= 3000;
+
+	neighborhood_sweep::options opts;
+	opts.thread_count = 2;
+
+	neighborhood_sweep::sweep_result r = neighborhood_sweep::run(base, 100, opts);
+
+	for (size_t k = 0; k < r.members.size(); k++) {
+		mpz_class start_value = base + k;
+
+		collatz_checker_slow checker;
+		checker.start_value_ref() = start_value;
+		checker.complete_check();
+
+		ensure_matching(r.members[k].step_count_evn, checker.step_count_evn, r.members[k].step_count_odd,
+				checker.step_count_odd);
+	}
+}
+
+// writes a value to a limb file and checks it from a view of the mapped file
+void test_limb_file() {
+	std::string path = (std::filesystem::temp_directory_path() / "collatz_huge_fast_test.limbs").string();
+
+	mpz_class start_value = 1;
+	start_value <<= 100000;
+	start_value++;
+
+	write_limb_file(path, start_value.get_mpz_t());
+
+	{
+		limb_file file(path);
+
+		mpz_t view;
+		file.view(view);
+
+		if (mpz_cmp(view, start_value.get_mpz_t()) != 0) {
+			throw std::runtime_error("limb file does not hold the written value");
+		}
+
+		collatz_checker_fast checker;
+		checker.start_value_assign(view);
+		checker.complete_check();
+
+		ensure_matching(checker.step_count_evn, 478838, checker.step_count_odd, 239020);
+	}
+
+	std::filesystem::remove(path);
+}
+
+void test_batch_consistency() {
+	// small values, values around the round limits and big ones that escape
+	vector<uint64_t> start_values = { 1, 2, 3, 27, 511, 512, 513, 97, 871, 77031, 837799 };
+	vector<mp_limb_t> limbs = random_limbs(1000, 0);
+	for (size_t i = 0; i < limbs.size(); i++) {
+		start_values.push_back((limbs[i] >> (i % 64)) | 1);
+	}
+
+	vector<collatz_batch::step_counts> results(start_values.size());
+
+	for (size_t impact_width : collatz_multistep::IMPACT_WIDTH_LIST) {
+		for (auto k : collatz_batch::KERNEL_LIST) {
+			if (!collatz_batch::is_supported(k)) {
+				continue;
+			}
+
+			collatz_batch::check(start_values.data(), start_values.size(), results.data(), k, impact_width);
+
+			for (size_t i = 0; i < start_values.size(); i++) {
+				collatz_checker_fixed<4> checker;
+				checker.start_value_ref() = mpz_class(start_values[i]);
+				checker.start_value_modified();
+				checker.complete_check();
+
+				ensure_matching(results[i].evn, checker.step_count_evn, results[i].odd, checker.step_count_odd);
+			}
+		}
+	}
+}
+
+// every checker with a memo table and cache against the same without
+void test_stopping_time_memo() {
+	std::string path = (std::filesystem::temp_directory_path() / "collatz_huge_fast_test.memo").string();
+	stopping_time_memo::write_table_file(path, 16);
+	stopping_time_memo::attach_table_file(path);
+	std::filesystem::remove(path);
+
+	vector<uint64_t> start_values = { 1, 2, 3, 27, 65535, 65536, 65537, 837799, 0xFFFFFFFFFFFFFFFFull };
+	vector<mp_limb_t> limbs = random_limbs(1000, 0);
+	for (size_t i = 0; i < limbs.size(); i++) {
+		start_values.push_back((limbs[i] >> (i % 64)) | 1);
+	}
+
+	vector<collatz_batch::step_counts> expected(start_values.size());
+	collatz_batch::check(start_values.data(), start_values.size(), expected.data());
+
+	mpz_class big_value = 1;
+	big_value <<= 3000;
+	big_value += 27;
+
+	collatz_checker_fast expected_big;
+	expected_big.start_value_assign(big_value.get_mpz_t());
+	expected_big.complete_check();
+
+	for (size_t cache_bits : { 0, 10 }) {
+		stopping_time_memo::enable(cache_bits);
+
+		vector<collatz_batch::step_counts> results(start_values.size());
+
+		for (auto k : collatz_batch::KERNEL_LIST) {
+			if (!collatz_batch::is_supported(k)) {
+				continue;
+			}
+
+			collatz_batch::check(start_values.data(), start_values.size(), results.data(), k);
+
+			for (size_t i = 0; i < start_values.size(); i++) {
+				ensure_matching(results[i].evn, expected[i].evn, results[i].odd, expected[i].odd);
+			}
+		}
+
+		for (size_t i = 0; i < start_values.size(); i++) {
+			collatz_checker_fixed<4> fixed;
+			fixed.start_value_ref() = mpz_class(start_values[i]);
+			fixed.start_value_modified();
+			fixed.complete_check();
+
+			ensure_matching(fixed.step_count_evn, expected[i].evn, fixed.step_count_odd, expected[i].odd);
+		}
+
+		collatz_checker_slow slow;
+		slow.start_value_ref() = big_value;
+		slow.complete_check();
+
+		collatz_checker_fast fast;
+		fast.start_value_assign(big_value.get_mpz_t());
+		fast.complete_check();
+
+		ensure_matching(slow.step_count_evn, expected_big.step_count_evn, slow.step_count_odd,
+				expected_big.step_count_odd);
+		ensure_matching(fast.step_count_evn, expected_big.step_count_evn, fast.step_count_odd,
+				expected_big.step_count_odd);
+	}
+
+	stopping_time_memo::disable();
+}
+
+// grows a block through the pools, malloc() and a mapping and back, which
+// keeps its contents. runs only without the installed allocator, as it
+// configures another one.
+void test_gmp_allocator() {
+	if (gmp_allocator::is_installed()) {
+		return;
+	}
+
+	gmp_allocator::config saved = gmp_allocator::get_config();
+
+	gmp_allocator::config c;
+	c.pool_max_bytes = 256;
+	c.huge_page_min_bytes = 1 << 16;
+	gmp_allocator::configure(c);
+
+	gmp_allocator::statistics before = gmp_allocator::get_statistics();
+
+	vector<size_t> sizes = { 24, 200, 256, 1000, 70000, 300000, 5000000, 100000, 4000, 100, 8 };
+
+	size_t old_size = 16;
+	unsigned char *p = static_cast<unsigned char*>(gmp_allocator::allocate(old_size));
+	std::memset(p, 0x5A, old_size);
+
+	for (size_t new_size : sizes) {
+		p = static_cast<unsigned char*>(gmp_allocator::reallocate(p, old_size, new_size));
+
+		for (size_t i = 0; i < std::min(old_size, new_size); i++) {
+			if (p[i] != (unsigned char) (i * 7 + old_size)) {
+				if (old_size != 16 || p[i] != 0x5A) {
+					throw std::runtime_error("reallocate() lost the contents of a block");
+				}
+			}
+		}
+
+		for (size_t i = 0; i < new_size; i++) {
+			p[i] = (unsigned char) (i * 7 + new_size);
+		}
+
+		old_size = new_size;
+	}
+
+	gmp_allocator::deallocate(p, old_size);
+
+	// freed small blocks are reused, also by other threads
+	std::thread t([]() {
+		for (size_t i = 0; i < 1000; i++) {
+			gmp_allocator::deallocate(gmp_allocator::allocate(48), 48);
+		}
+	});
+	t.join();
+
+	gmp_allocator::statistics d = gmp_allocator::get_statistics() - before;
+
+	if (d.allocations != 1001 || d.reallocations != sizes.size() || d.frees != 1001 || d.pool_hits < 999
+			|| d.mappings < 2) {
+		throw std::runtime_error("unexpected gmp allocator statistics " + d.str());
+	}
+
+	gmp_allocator::configure(saved);
+}
+
+void test_residue_sieve() {
+	// survivors of the 2^k sieve, as listed in the literature
+	const size_t expected[][2] = { { 8, 19 }, { 16, 2114 }, { 20, 27328 }, { 24, 286581 } };
+
+	for (const auto &e : expected) {
+		residue_sieve sieve(e[0]);
+
+		if (sieve.survivor_count() != e[1]) {
+			cout << "survivors mod 2^" << e[0] << ": " << sieve.survivor_count() << " (expected: " << e[1] << ")\n";
+			throw std::runtime_error("residue sieve incorrect");
+		}
 	}
 }
 
@@ -123,12 +636,668 @@ void test_very_large_number() {
 			<< ela::format_dura(t) << "\t" //
 			<< ela::format_dura_s(t) << //
 			"\n";
+
+	cout << power_of_3_big::thread_cache().stats().str() << "\n";
+}
+
+void write_pow3_table(const std::string &path, size_t entry_count) {
+	cout << "writing 3^0..3^" << (entry_count - 1) << " to " << path << "\n" << flush;
+
+	ela::elapsed_time_ns t = ela::system_time();
+
+	power_of_3_big::write_table_file(path, entry_count);
+
+	cout << "done in " << ela::dura_since(t) << "\n";
+}
+
+// times all supported batch kernels on value_count pseudo random start values
+// below 2^40
+void batch_bench(size_t value_count) {
+	vector<uint64_t> start_values = random_limbs(value_count, 0);
+	for (auto &v : start_values) {
+		v = (v >> 24) | 1;
+	}
+
+	vector<collatz_batch::step_counts> expected;
+
+	cout << "kernel" << "\t" << "runtime" << "\t" << "values/s" << "\t" << "steps/s" << "\n";
+
+	for (auto k : collatz_batch::KERNEL_LIST) {
+		if (!collatz_batch::is_supported(k)) {
+			cout << collatz_batch::get_name(k) << "\tnot supported\n";
+			continue;
+		}
+
+		vector<collatz_batch::step_counts> results(value_count);
+
+		ela::elapsed_time_ns best = 0;
+		for (size_t rep = 0; rep < 3; rep++) {
+			ela::elapsed_time_ns t = ela::steady_time();
+			collatz_batch::check(start_values.data(), value_count, results.data(), k);
+			t = ela::steady_time() - t;
+
+			if (rep == 0 || t < best) {
+				best = t;
+			}
+		}
+
+		uint64_t step_count = 0;
+		for (const auto &r : results) {
+			step_count += r.evn + r.odd;
+		}
+
+		if (expected.empty()) {
+			expected = results;
+		}
+
+		for (size_t i = 0; i < value_count; i++) {
+			if (results[i].evn != expected[i].evn || results[i].odd != expected[i].odd) {
+				throw std::runtime_error(std::string("batch kernel mismatch: ") + collatz_batch::get_name(k));
+			}
+		}
+
+		double seconds = std::max(best, (ela::elapsed_time_ns) 1) / 1e9;
+
+		cout << "" //
+				<< collatz_batch::get_name(k) << "\t" //
+				<< ela::format_dura(best) << "\t" //
+				<< amf::format_metric((long long) (value_count / seconds)) << "\t" //
+				<< amf::format_metric((long long) (step_count / seconds)) << "\n";
+	}
+}
+
+template<typename T>
+struct type_tag {
+	typedef T type;
+};
+
+// calls func with type_tag<CHECKER> for the checker of the specified name
+template<typename FUNC>
+void with_checker(const std::string &name, FUNC &&func) {
+	if (name == "naive") {
+		func(type_tag<collatz_checker_naive>());
+	} else if (name == "slow") {
+		func(type_tag<collatz_checker_slow>());
+	} else if (name == "fast") {
+		func(type_tag<collatz_checker_fast>());
+	} else if (name == "dc") {
+		func(type_tag<collatz_checker_dc>());
+	} else if (name == "fixed") {
+		func(type_tag<collatz_checker_fixed<4>>());
+	} else {
+		throw std::runtime_error("unknown checker " + name);
+	}
+}
+
+// positional arguments and options of the form --name value
+struct command_line {
+	vector<std::string> positional;
+	std::map<std::string, std::string> options;
+
+	command_line(int argc, char **argv) {
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+
+			if (arg.compare(0, 2, "--") != 0) {
+				positional.push_back(arg);
+			} else if (i + 1 < argc) {
+				options[arg.substr(2)] = argv[++i];
+			} else {
+				throw std::runtime_error("missing value for option " + arg);
+			}
+		}
+	}
+
+	// removes and returns the value of the specified option, or default_value
+	std::string take(const std::string &name, const std::string &default_value) {
+		auto it = options.find(name);
+		if (it == options.end()) {
+			return default_value;
+		}
+
+		std::string value = it->second;
+		options.erase(it);
+		return value;
+	}
+};
+
+void run_range(const mpz_class &begin, const mpz_class &end, const std::string &checker_name,
+		const range_verifier::options &opts) {
+	cout << "verifying [" << begin << ", " << end << ") with " << opts.thread_count << " threads\n" << flush;
+
+	ela::elapsed_time_ns t = ela::system_time();
+
+	range_verifier::range_result r;
+	with_checker(checker_name, [&](auto checker_type) {
+		r = range_verifier::verify<typename decltype(checker_type)::type>(begin, end, opts);
+	});
+
+	t = ela::system_time() - t;
+
+	cout << "" //
+			<< "chunks..........: " << r.chunk_count << " (" << r.resumed_chunk_count << " from checkpoint)\n" //
+			<< "checked.........: " << r.total.checked_count << "\n" //
+			<< "skipped.........: " << r.total.skipped_count << "\n" //
+			<< "total_steps.....: " << r.total.total_steps << "\n" //
+			<< "max_steps.......: " << r.total.max_steps << "\n" //
+			<< "max_steps_start.: " << r.total.max_steps_witness << "\n" //
+			<< "runtime.........: " << ela::format_dura(t) << "\n" //
+			;
+}
+
+// a decimal or 0x hexadecimal number, or B^E, B^E+K or B^E-K
+mpz_class parse_value(const std::string &text) {
+	size_t pow = text.find('^');
+	if (pow == std::string::npos) {
+		return mpz_class(text);
+	}
+
+	size_t sign = text.find_first_of("+-", pow);
+
+	mpz_class base(text.substr(0, pow));
+	unsigned long exponent = std::stoul(text.substr(pow + 1, sign - pow - 1));
+
+	mpz_class result;
+	mpz_pow_ui(result.get_mpz_t(), base.get_mpz_t(), exponent);
+
+	if (sign != std::string::npos) {
+		mpz_class offset(text.substr(sign + 1));
+		result += text[sign] == '+' ? offset : -offset;
+	}
+
+	return result;
+}
+
+struct check_options {
+	std::string snapshot_path;
+	double snapshot_interval_s = 600;
+
+	// "-" for stdout
+	std::string chain_stats_path;
+	double chain_stats_interval_s = 60;
+
+	// progress is printed every progress_interval_s if it is not 0, and the
+	// status file is rewritten as often, by default every 10 seconds
+	double progress_interval_s = 0;
+	std::string progress_path;
+};
+
+// only the fast checker with chain_stats has stats to write
+template<typename CHECKER>
+void set_stats_output(CHECKER&, std::ostream*, double) {
+}
+
+void set_stats_output(basic_collatz_checker_fast<chain_stats> &checker, std::ostream *out, double interval_s) {
+	checker.stats_out = out;
+	checker.stats_interval = (ela::elapsed_time_ns) (interval_s * ela::NS_PER_SEC);
+}
+
+template<typename CHECKER>
+void run_check(mpz_srcptr start_value, const check_options &opts) {
+	CHECKER checker;
+	checker.snapshot_path = opts.snapshot_path;
+	checker.snapshot_interval = (ela::elapsed_time_ns) (opts.snapshot_interval_s * ela::NS_PER_SEC);
+
+	std::ofstream stats_file;
+	if (opts.chain_stats_path == "-") {
+		set_stats_output(checker, &cout, opts.chain_stats_interval_s);
+	} else if (!opts.chain_stats_path.empty()) {
+		stats_file.open(opts.chain_stats_path, std::ios::app);
+		if (!stats_file) {
+			throw std::runtime_error("cannot open " + opts.chain_stats_path);
+		}
+
+		set_stats_output(checker, &stats_file, opts.chain_stats_interval_s);
+	}
+
+	if (!opts.snapshot_path.empty() && checker.resume()) {
+		cout << "resuming " << checker.type_abbrev() << " from " << opts.snapshot_path << " at iteration "
+				<< checker.iter_count << "\n" << flush;
+	} else {
+		checker.start_value_assign(start_value);
+
+		cout << "checking start value of bitlen " << mpz_sizeinbase(start_value, 2) << " with " << checker.type_abbrev() << "\n"
+				<< flush;
+	}
+
+	progress_counters progress;
+	std::unique_ptr<progress_reporter> reporter;
+
+	if (opts.progress_interval_s > 0 || !opts.progress_path.empty()) {
+		checker.progress = &progress;
+		checker.publish_progress();
+
+		double interval_s = opts.progress_interval_s > 0 ? opts.progress_interval_s : 10;
+		reporter.reset(new progress_reporter(progress, opts.progress_interval_s > 0 ? &cout : nullptr,
+				opts.progress_path, (ela::elapsed_time_ns) (interval_s * ela::NS_PER_SEC)));
+	}
+
+	gmp_allocator::statistics alloc_stats = gmp_allocator::get_statistics();
+	ela::elapsed_time_ns t = ela::system_time();
+
+	checker.complete_check();
+
+	t = ela::system_time() - t;
+	alloc_stats = gmp_allocator::get_statistics() - alloc_stats;
+
+	reporter.reset();
+
+	cout << "" //
+			<< "step_count_evn..: " << checker.step_count_evn << "\n" //
+			<< "step_count_odd..: " << checker.step_count_odd << "\n" //
+			<< "step_count......: " << checker.step_count() << "\n" //
+			<< "iterations......: " << checker.iter_count << "\n" //
+			<< "runtime.........: " << ela::format_dura(t) << "\n" //
+			;
+
+	if (gmp_allocator::is_installed()) {
+		cout << alloc_stats.str() << "\n";
+	}
+}
+
+// loads the dispatch profile at path, or calibrates one and saves it there
+void select_dispatch_profile(const std::string &path, std::ostream *log) {
+	if (!path.empty() && checker_dispatch::load(path, checker_dispatch::selected_profile)) {
+		return;
+	}
+
+	checker_dispatch::selected_profile = checker_dispatch::calibrate(log);
+
+	if (!path.empty()) {
+		checker_dispatch::save(path, checker_dispatch::selected_profile);
+	}
+}
+
+void run_dispatched_check(mpz_srcptr start_value) {
+	cout << "checking start value of bitlen " << mpz_sizeinbase(start_value, 2) << " with auto\n" << flush;
+
+	gmp_allocator::statistics alloc_stats = gmp_allocator::get_statistics();
+	ela::elapsed_time_ns t = ela::system_time();
+
+	checker_dispatch::result r;
+	checker_dispatch::check(start_value, r);
+
+	t = ela::system_time() - t;
+	alloc_stats = gmp_allocator::get_statistics() - alloc_stats;
+
+	cout << "" //
+			<< "checkers........: " << r.checkers << "\n" //
+			<< "step_count_evn..: " << r.step_count_evn << "\n" //
+			<< "step_count_odd..: " << r.step_count_odd << "\n" //
+			<< "step_count......: " << r.step_count_evn + r.step_count_odd << "\n" //
+			<< "iterations......: " << r.iter_count << "\n" //
+			<< "runtime.........: " << ela::format_dura(t) << "\n" //
+			;
+
+	if (gmp_allocator::is_installed()) {
+		cout << alloc_stats.str() << "\n";
+	}
+}
+
+void write_limbs(const std::string &path, const std::string &value_text) {
+	ela::elapsed_time_ns t = ela::system_time();
+
+	mpz_class value;
+
+	if (value_text[0] == '@') {
+		std::ifstream in(value_text.substr(1));
+		std::string text;
+
+		if (!(in >> text)) {
+			throw std::runtime_error("cannot read a number from " + value_text.substr(1));
+		}
+
+		value = mpz_class(text);
+	} else {
+		value = parse_value(value_text);
+	}
+
+	cout << "writing " << mpz_size(value.get_mpz_t()) << " limbs to " << path << "\n" << flush;
+
+	write_limb_file(path, value.get_mpz_t());
+
+	cout << "done in " << ela::dura_since(t) << "\n";
+}
+
+void print_usage() {
+	cout << "" //
+			<< "usage: collatz_huge_fast [COMMAND] [OPTIONS]\n" //
+			<< "\n" //
+			<< "commands:\n" //
+			<< "  test (default)\n" //
+			<< "      run the self tests\n" //
+			<< "  batch-bench [VALUE_COUNT]\n" //
+			<< "      time the batch kernels on VALUE_COUNT random start values\n" //
+			<< "  write-pow3-table FILE ENTRY_COUNT\n" //
+			<< "      write 3^0..3^(ENTRY_COUNT-1) to a table file for --pow3-table\n" //
+			<< "  write-memo-table FILE BITS\n" //
+			<< "      write the step counts of all values below 2^BITS for --memo-table\n" //
+			<< "  write-limbs FILE VALUE\n" //
+			<< "      write VALUE, e.g. 2^100000000-1, 3^5000, 0x1f or @TEXT_FILE with a\n" //
+			<< "      decimal or 0x hexadecimal number, to a limb file\n" //
+			<< "  check START [--snapshot FILE] [--snapshot-interval SECONDS]\n" //
+			<< "        [--chain-stats FILE|-] [--chain-stats-interval SECONDS]\n" //
+			<< "        [--progress SECONDS] [--progress-file FILE]\n" //
+			<< "      count the steps of START, e.g. 2^1000000+1 or @LIMB_FILE, with the\n" //
+			<< "      slow, fast or auto checker. its state is saved to FILE every SECONDS\n" //
+			<< "      (default 600), and an existing FILE is continued instead of START.\n" //
+			<< "      the fast checker appends json lines with per level counters of its\n" //
+			<< "      chain to the chain stats FILE every SECONDS (default 60) and at the\n" //
+			<< "      end. --progress prints the rates and an eta every SECONDS, and\n" //
+			<< "      --progress-file keeps them in FILE\n" //
+			<< "  stream [FILE|-] [--input text|limbs] [--output csv|jsonl] [--threads N]\n" //
+			<< "        [--max-bitlen on|off]\n" //
+			<< "      check the values of FILE or stdin, one decimal or 0x hexadecimal value\n" //
+			<< "      per line or a limb stream, and write one record per value. values\n" //
+			<< "      below 2^64 use the batch kernels unless --max-bitlen is on, bigger\n" //
+			<< "      ones the auto checker\n" //
+			<< "  sweep BASE [--offsets COUNT] [--threads N]\n" //
+			<< "      check BASE + k for k below COUNT (default 2^20), e.g. for BASE\n" //
+			<< "      2^1000000, and write them as csv lines. the offsets share one\n" //
+			<< "      multiplication of the upper part of BASE per exponent of their first\n" //
+			<< "      steps. COUNT may not exceed the lowest set bit of BASE\n" //
+			<< "  calibrate-dispatch\n" //
+			<< "      time the checkers and print the crossovers of the auto checker\n" //
+			<< "  tune-chain [--tune-bits BITS,...] [--chain-geometry FILE]\n" //
+			<< "      search the fastest accu_chain geometry of the fast checker on values\n" //
+			<< "      of the given bit lengths (default 100000,1000000) and write it to FILE\n" //
+			<< "  regress [--quick on|off] [--baseline FILE] [--write-baseline FILE]\n" //
+			<< "        [--tolerance FRACTION]\n" //
+			<< "      check the golden step counts of large reference values with every\n" //
+			<< "      checker and compare the runtimes to a baseline written earlier on\n" //
+			<< "      this machine. --quick on skips the 10^7 bit values\n" //
+			<< "  range BEGIN END [--threads N] [--chunk-size N] [--checkpoint FILE]\n" //
+			<< "        [--sieve-bits 0..32] [--mod3-filter on|off] [--glide on|off]\n" //
+			<< "        [--batch on|off]\n" //
+			<< "      verify all start values in [BEGIN, END), resuming from FILE. values\n" //
+			<< "      sieved out or filtered converge if all values below BEGIN do. with\n" //
+			<< "      --glide on, values are only checked until they drop below themselves.\n" //
+			<< "      with --batch on, full checks below 2^64 use the batch kernels\n" //
+			<< "\n" //
+			<< "options:\n" //
+			<< "  --checker fixed|naive|slow|fast|dc checker, fixed for range and fast\n" //
+			<< "            |auto                    for check by default. auto starts\n" //
+			<< "                                     on the fastest checker for the size\n" //
+			<< "                                     and hands the value down as it shrinks\n" //
+			<< "  --dispatch-profile FILE            crossovers of the auto checker, which\n" //
+			<< "                                     are calibrated and saved if missing\n" //
+			<< "  --pow3-table FILE                  use a mapped power of 3 table\n" //
+			<< "  --memo-table FILE                  finish single limb values with a mapped\n" //
+			<< "                                     step count table\n" //
+			<< "  --memo-cache-bits N                and a cache of 2^N values per thread\n" //
+			<< "  --gmp-allocator default|pool       gmp allocations from pools per thread\n" //
+			<< "                                     and mapped big blocks, with counters\n" //
+			<< "                                     printed by check\n" //
+			<< "  --huge-pages off|transparent       huge pages for the mapped blocks of the\n" //
+			<< "            |explicit                pool allocator, explicit from the\n" //
+			<< "                                     reserved ones\n" //
+			<< "  --huge-page-min-mb MB              smallest mapped block (default 4)\n" //
+			<< "  --impact-width auto|8|11|12|16     combined impact table width\n" //
+			<< "  --mul-threads N                    threads for big multiplications\n" //
+			<< "  --mul-cutover LIMBS                minimum size for multithreading\n" //
+			<< "  --chain-geometry FILE              accu_chain geometry from tune-chain\n" //
+			;
 }
 
-int main() {
-	test_3_algorithms_consistency();
+int run_command(int argc, char **argv) {
+	command_line cl(argc, argv);
+
+	std::string command = cl.positional.empty() ? "test" : cl.positional[0];
+
+	// before anything allocates through gmp
+	gmp_allocator::config alloc_config;
+	std::string huge_pages = cl.take("huge-pages", "transparent");
+	if (huge_pages == "off") {
+		alloc_config.huge_pages = gmp_allocator::huge_page_mode::off;
+	} else if (huge_pages == "explicit") {
+		alloc_config.huge_pages = gmp_allocator::huge_page_mode::explicit_pages;
+	} else if (huge_pages != "transparent") {
+		throw std::runtime_error("unknown huge page mode " + huge_pages);
+	}
+	alloc_config.huge_page_min_bytes = std::stoull(
+			cl.take("huge-page-min-mb", std::to_string(alloc_config.huge_page_min_bytes >> 20))) << 20;
+
+	std::string gmp_alloc = cl.take("gmp-allocator", "default");
+	if (gmp_alloc == "pool") {
+		gmp_allocator::configure(alloc_config);
+		gmp_allocator::install();
+	} else if (gmp_alloc != "default") {
+		throw std::runtime_error("unknown gmp allocator " + gmp_alloc);
+	}
+
+	std::string pow3_table = cl.take("pow3-table", "");
+	if (!pow3_table.empty()) {
+		power_of_3_big::attach_table_file(pow3_table);
+	}
+
+	std::string memo_table = cl.take("memo-table", "");
+	std::string memo_cache_bits = cl.take("memo-cache-bits", "");
+	if (!memo_table.empty()) {
+		stopping_time_memo::attach_table_file(memo_table);
+	}
+	if (!memo_table.empty() || !memo_cache_bits.empty()) {
+		stopping_time_memo::enable(memo_cache_bits.empty() ? 0 : std::stoull(memo_cache_bits));
+	}
+
+	parallel_mul::config mul_config;
+	mul_config.thread_count = std::stoull(cl.take("mul-threads", std::to_string(mul_config.thread_count)));
+	mul_config.cutover_limbs = std::stoull(cl.take("mul-cutover", std::to_string(mul_config.cutover_limbs)));
+	parallel_mul::configure(mul_config);
+
+	std::string chain_geometry_path = cl.take("chain-geometry", "");
+	if (!chain_geometry_path.empty() && command != "tune-chain") {
+		if (!load_chain_geometry(chain_geometry_path, selected_chain_geometry)) {
+			throw std::runtime_error("cannot open " + chain_geometry_path);
+		}
+	}
+
+	vector<size_t> tune_bit_lengths;
+	std::istringstream tune_bits(cl.take("tune-bits", "100000,1000000"));
+	for (std::string bits; std::getline(tune_bits, bits, ',');) {
+		tune_bit_lengths.push_back(std::stoull(bits));
+	}
+
+	std::string impact_width = cl.take("impact-width", "auto");
+	if (impact_width == "auto") {
+		collatz_multistep::selected_impact_width = collatz_multistep::calibrate_impact_width();
+	} else {
+		collatz_multistep::selected_impact_width = std::stoull(impact_width);
+		collatz_multistep::with_impact_width(collatz_multistep::selected_impact_width, [](auto) {
+		});
+	}
+
+	std::string checker_name = cl.take("checker", "");
+
+	std::string dispatch_profile_path = cl.take("dispatch-profile", "");
+
+	regression_suite::options regress_opts;
+	regress_opts.quick = cl.take("quick", "off") == "on";
+	regress_opts.baseline_path = cl.take("baseline", "");
+	regress_opts.write_baseline_path = cl.take("write-baseline", "");
+	regress_opts.tolerance = std::stod(cl.take("tolerance", std::to_string(regress_opts.tolerance)));
+
+	check_options check_opts;
+	check_opts.snapshot_path = cl.take("snapshot", "");
+	check_opts.snapshot_interval_s = std::stod(cl.take("snapshot-interval", "600"));
+	check_opts.chain_stats_path = cl.take("chain-stats", "");
+	check_opts.chain_stats_interval_s = std::stod(cl.take("chain-stats-interval", "60"));
+	check_opts.progress_interval_s = std::stod(cl.take("progress", "0"));
+	check_opts.progress_path = cl.take("progress-file", "");
+
+	range_verifier::options range_opts;
+	range_opts.thread_count = std::stoull(cl.take("threads", std::to_string(range_opts.thread_count)));
+	range_opts.chunk_size = std::stoull(cl.take("chunk-size", std::to_string(range_opts.chunk_size)));
+	range_opts.checkpoint_path = cl.take("checkpoint", "");
+	range_opts.sieve_bits = std::stoull(cl.take("sieve-bits", std::to_string(range_opts.sieve_bits)));
+	range_opts.mod3_filter = cl.take("mod3-filter", range_opts.mod3_filter ? "on" : "off") == "on";
+	range_opts.stop_below_start = cl.take("glide", range_opts.stop_below_start ? "on" : "off") == "on";
+	range_opts.batch = cl.take("batch", range_opts.batch ? "on" : "off") == "on";
+
+	stream_checker::options stream_opts;
+	stream_opts.thread_count = range_opts.thread_count;
+	stream_opts.input = cl.take("input", "text") == "limbs" ? stream_checker::input_format::limbs :
+			stream_checker::input_format::text;
+	stream_opts.output = cl.take("output", "csv") == "jsonl" ? stream_checker::output_format::jsonl :
+			stream_checker::output_format::csv;
+	stream_opts.max_bitlen = cl.take("max-bitlen", "off") == "on";
+
+	neighborhood_sweep::options sweep_opts;
+	sweep_opts.thread_count = range_opts.thread_count;
+	uint64_t sweep_offset_count = std::stoull(cl.take("offsets", std::to_string(1 << 20)));
+
+	if (!cl.options.empty()) {
+		cout << "unknown option --" << cl.options.begin()->first << "\n";
+		print_usage();
+		return 1;
+	}
+
+	if (command == "test" && cl.positional.size() <= 1) {
+		cout << "combined impact table width: " << collatz_multistep::selected_impact_width << "\n";
+
+		test_algorithms_consistency();
+
+		test_large_number_consistency();
 
-	test_very_large_number();
+		test_glide_consistency();
+
+		test_snapshot_consistency();
+
+		test_limb_file();
+
+		test_dispatch_handoff();
+
+		test_run_shortcuts();
+
+		test_neighborhood_sweep();
+
+		test_chain_geometry();
+
+		test_parallel_mul();
+
+		test_residue_sieve();
+
+		test_batch_consistency();
+
+		test_stopping_time_memo();
+
+		test_gmp_allocator();
+
+		test_very_large_number();
+
+	} else if (command == "write-pow3-table" && cl.positional.size() == 3) {
+		write_pow3_table(cl.positional[1], std::stoull(cl.positional[2]));
+
+	} else if (command == "write-memo-table" && cl.positional.size() == 3) {
+		stopping_time_memo::write_table_file(cl.positional[1], std::stoull(cl.positional[2]));
+
+	} else if (command == "batch-bench" && cl.positional.size() <= 2) {
+		batch_bench(cl.positional.size() == 2 ? std::stoull(cl.positional[1]) : 1 << 20);
+
+	} else if (command == "write-limbs" && cl.positional.size() == 3) {
+		write_limbs(cl.positional[1], cl.positional[2]);
+
+	} else if (command == "check" && cl.positional.size() == 2) {
+		// a limb file is viewed in place, anything else is parsed
+		std::string start_text = cl.positional[1];
+
+		limb_file start_file;
+		mpz_class parsed;
+		mpz_t start_value;
+
+		if (start_text[0] == '@') {
+			start_file.open(start_text.substr(1));
+			start_file.view(start_value);
+		} else {
+			parsed = parse_value(start_text);
+			mpz_roinit_n(start_value, mpz_limbs_read(parsed.get_mpz_t()), mpz_size(parsed.get_mpz_t()));
+		}
+
+		if (checker_name == "auto") {
+			if (!check_opts.snapshot_path.empty() || !check_opts.chain_stats_path.empty()) {
+				throw std::runtime_error("the auto checker has no snapshots or chain stats");
+			}
+
+			select_dispatch_profile(dispatch_profile_path, nullptr);
+			run_dispatched_check(start_value);
+		} else if ((checker_name == "" || checker_name == "fast") && !check_opts.chain_stats_path.empty()) {
+			run_check<basic_collatz_checker_fast<chain_stats>>(start_value, check_opts);
+		} else if (checker_name == "" || checker_name == "fast") {
+			run_check<collatz_checker_fast>(start_value, check_opts);
+		} else if (checker_name == "slow") {
+			run_check<collatz_checker_slow>(start_value, check_opts);
+		} else {
+			throw std::runtime_error("the check command needs the slow, fast or auto checker");
+		}
+
+	} else if (command == "stream" && cl.positional.size() <= 2) {
+		std::string path = cl.positional.size() == 2 ? cl.positional[1] : "-";
+
+		std::ifstream file;
+		if (path != "-") {
+			file.open(path, std::ios::binary);
+			if (!file) {
+				throw std::runtime_error("cannot open " + path);
+			}
+		}
+
+		select_dispatch_profile(dispatch_profile_path, nullptr);
+
+		std::ios::sync_with_stdio(false);
+		stream_checker::run(path == "-" ? std::cin : file, cout, stream_opts);
+
+	} else if (command == "sweep" && cl.positional.size() == 2) {
+		select_dispatch_profile(dispatch_profile_path, nullptr);
+
+		neighborhood_sweep::sweep_result r = neighborhood_sweep::run(parse_value(cl.positional[1]), sweep_offset_count,
+				sweep_opts);
+
+		std::ios::sync_with_stdio(false);
+		neighborhood_sweep::write_csv(r, cout);
+
+	} else if (command == "calibrate-dispatch" && cl.positional.size() == 1) {
+		checker_dispatch::selected_profile = checker_dispatch::calibrate(&cout);
+
+		if (!dispatch_profile_path.empty()) {
+			checker_dispatch::save(dispatch_profile_path, checker_dispatch::selected_profile);
+		}
+
+		cout << checker_dispatch::selected_profile.str();
+
+	} else if (command == "tune-chain" && cl.positional.size() == 1) {
+		selected_chain_geometry = tune_chain_geometry(tune_bit_lengths, &cout);
+
+		if (!chain_geometry_path.empty()) {
+			save_chain_geometry(chain_geometry_path, selected_chain_geometry);
+		}
+
+		cout << selected_chain_geometry.str();
+
+	} else if (command == "regress" && cl.positional.size() == 1) {
+		size_t failure_count = regression_suite::run(regress_opts, cout);
+
+		if (failure_count != 0) {
+			cout << failure_count << " failures\n";
+			return 1;
+		}
+
+	} else if (command == "range" && cl.positional.size() == 3) {
+		run_range(mpz_class(cl.positional[1]), mpz_class(cl.positional[2]), checker_name == "" ? "fixed" : checker_name,
+				range_opts);
+
+	} else {
+		print_usage();
+		return 1;
+	}
 
 	return 0;
 }
+
+int main(int argc, char **argv) {
+	try {
+		return run_command(argc, argv);
+	} catch (const std::exception &e) {
+		cout << flush;
+		std::cerr << "error: " << e.what() << "\n";
+		return 1;
+	}
+}
@@ -0,0 +1,58 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+using std::string;
+
+static void throw_errno(const string &what, const string &path) {
+	throw std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+void mapped_file::open(const string &path) {
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw_errno("cannot open", path);
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		throw_errno("cannot stat", path);
+	}
+
+	length = st.st_size;
+
+	if (length == 0) {
+		::close(fd);
+		throw std::runtime_error("cannot map empty file " + path);
+	}
+
+	void *p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	if (p == MAP_FAILED) {
+		length = 0;
+		throw_errno("cannot mmap", path);
+	}
+
+	data = static_cast<const char*>(p);
+	this->path = path;
+}
+
+void mapped_file::close() {
+	if (data != nullptr) {
+		munmap(const_cast<char*>(data), length);
+	}
+
+	data = nullptr;
+	length = 0;
+	path.clear();
+}
@@ -0,0 +1,51 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <stddef.h>
+#include <string>
+
+// a file mapped read-only into memory. all processes mapping the same file
+// share the pages of the page cache.
+class mapped_file {
+public:
+	mapped_file() {
+	}
+
+	explicit mapped_file(const std::string &path) {
+		open(path);
+	}
+
+	~mapped_file() {
+		close();
+	}
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	void open(const std::string &path);
+
+	void close();
+
+	bool is_open() const {
+		return data != nullptr;
+	}
+
+	const char* begin() const {
+		return data;
+	}
+
+	size_t size() const {
+		return length;
+	}
+
+	const std::string& get_path() const {
+		return path;
+	}
+
+private:
+	const char *data = nullptr;
+	size_t length = 0;
+	std::string path;
+};
+
+#endif /* MAPPED_FILE_H_ */
@@ -4,9 +4,14 @@
 #include <gmp.h>
 #include <gmpxx.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdexcept>
+#include <vector>
 
 const size_t LIMB_BITSIZE = sizeof(mp_limb_t) * 8;
 
+typedef unsigned __int128 dbl_limb_t;
+
 inline size_t size(mpz_class &c) {
 	return mpz_size(c.get_mpz_t());
 }
@@ -23,4 +28,54 @@ inline size_t number_of_trailing_zeros(mpz_class &c) {
 	return mpz_scan1(c.get_mpz_t(), 0);
 }
 
+inline mpz_class& operator+=(mpz_class &lhs, const dbl_limb_t &rhs) {
+	if (sizeof(dbl_limb_t) != 2 * sizeof(mp_limb_t)) {
+		throw std::runtime_error("sizeof(dbl_limb_t) is not double of sizeof(mp_limb_t)");
+	}
+
+	mpz_t rhs_mpz;
+	mpz_roinit_n(rhs_mpz, reinterpret_cast<const mp_limb_t*>(&rhs), 2);
+
+	mpz_add(lhs.get_mpz_t(), lhs.get_mpz_t(), rhs_mpz);
+
+	return lhs;
+}
+
+inline mpz_class operator+(mpz_class lhs, const dbl_limb_t &rhs) {
+	lhs += rhs;
+	return lhs;
+}
+
+// pseudo random limbs from xorshift64, so that tests and calibrations get
+// the same values with any gmp version. the same seed gives the same limbs.
+inline std::vector<mp_limb_t> random_limbs(size_t count, uint64_t seed) {
+	std::vector<mp_limb_t> limbs(count);
+
+	uint64_t x = 0x9E3779B97F4A7C15ull ^ seed;
+	for (auto &limb : limbs) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		limb = x;
+	}
+
+	return limbs;
+}
+
+// a pseudo random value of exactly bit_length >= 1 bits from random_limbs()
+inline mpz_class random_value(size_t bit_length, uint64_t seed) {
+	std::vector<mp_limb_t> limbs = random_limbs((bit_length + LIMB_BITSIZE - 1) / LIMB_BITSIZE, seed);
+
+	size_t top_bits = bit_length - (limbs.size() - 1) * LIMB_BITSIZE;
+	if (top_bits < LIMB_BITSIZE) {
+		limbs.back() &= (((mp_limb_t) 1) << top_bits) - 1;
+	}
+	limbs.back() |= ((mp_limb_t) 1) << (top_bits - 1);
+
+	mpz_class v;
+	mpz_import(v.get_mpz_t(), limbs.size(), -1, sizeof(mp_limb_t), 0, 0, limbs.data());
+
+	return v;
+}
+
 #endif /* MPZ_UTILS_H_ */
@@ -0,0 +1,99 @@
+#include "neighborhood_sweep.h"
+
+#include <stdexcept>
+
+#include "checker_dispatch.h"
+#include "collatz_multistep.h"
+#include "parallel_mul.h"
+#include "power_of_3_big.h"
+#include "thread_pool.h"
+
+namespace neighborhood_sweep {
+
+first_steps::first_steps(uint64_t k, size_t window) {
+	const size_t TABLE_STEP_COUNT = collatz_multistep::COMBINED_IMPACT_TABLE_STEP_COUNT;
+
+	carry = k;
+
+	size_t step_count_evn = 0;
+	size_t i = 0;
+
+	for (; i + TABLE_STEP_COUNT <= window; i += TABLE_STEP_COUNT) {
+		collatz_multistep::combined_impact_exactly<dbl_limb_t, TABLE_STEP_COUNT, TABLE_STEP_COUNT>(carry,
+				step_count_evn, exponent);
+	}
+
+	for (; i < window; i++) {
+		collatz_multistep::simple_single_step(carry, exponent);
+	}
+}
+
+sweep_result run(const mpz_class &base, uint64_t offset_count, const options &opts) {
+	if (opts.thread_count == 0) {
+		throw std::runtime_error("the thread count has to be at least 1");
+	}
+
+	if (base < 1 || offset_count == 0) {
+		throw std::runtime_error("a neighborhood needs a positive base and offsets");
+	}
+
+	sweep_result r;
+	r.window = offset_count == 1 ? 1 : LIMB_BITSIZE - __builtin_clzll(offset_count - 1);
+
+	size_t shift = mpz_scan1(base.get_mpz_t(), 0);
+	if (r.window > shift || r.window > MAX_WINDOW_BITS) {
+		throw std::runtime_error("the offsets have to fit below the lowest set bit of the base and into "
+				+ std::to_string(MAX_WINDOW_BITS) + " bits");
+	}
+
+	// the offsets by the exponent of their first steps
+	std::vector<std::vector<uint64_t>> groups(r.window + 1);
+	for (uint64_t k = 0; k < offset_count; k++) {
+		groups[first_steps(k, r.window).exponent].push_back(k);
+	}
+
+	mpz_class upper;
+	mpz_tdiv_q_2exp(upper.get_mpz_t(), base.get_mpz_t(), r.window);
+
+	r.members.resize(offset_count);
+
+	thread_pool pool(opts.thread_count);
+
+	for (size_t exponent = 0; exponent < groups.size(); exponent++) {
+		const std::vector<uint64_t> &group = groups[exponent];
+		if (group.empty()) {
+			continue;
+		}
+
+		r.group_count++;
+
+		mpz_class product = upper;
+		parallel_mul::mul(product, power_of_3_big::lookup(exponent));
+
+		pool.run(group.size(), [&](size_t i) {
+			uint64_t k = group[i];
+
+			mpz_class start_value = product;
+			start_value += first_steps(k, r.window).carry;
+
+			checker_dispatch::result d;
+			checker_dispatch::check(start_value.get_mpz_t(), d);
+
+			member_result &m = r.members[k];
+			m.step_count_evn = r.window + d.step_count_evn;
+			m.step_count_odd = exponent + d.step_count_odd;
+		});
+	}
+
+	return r;
+}
+
+void write_csv(const sweep_result &r, std::ostream &out) {
+	out << "k,step_count_evn,step_count_odd\n";
+
+	for (size_t k = 0; k < r.members.size(); k++) {
+		out << k << "," << r.members[k].step_count_evn << "," << r.members[k].step_count_odd << "\n";
+	}
+}
+
+} /* namespace neighborhood_sweep */
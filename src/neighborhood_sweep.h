@@ -0,0 +1,64 @@
+#ifndef NEIGHBORHOOD_SWEEP_H_
+#define NEIGHBORHOOD_SWEEP_H_
+
+#include <gmpxx.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "mpz_utils.h"
+
+// complete checks of the neighborhood base + k, k in [0, offset_count), of a
+// huge base = prefix * 2^shift with offset_count <= 2^shift.
+//
+// with w the bit length of offset_count - 1, the first w steps of
+// base + k = U * 2^w + k only depend on k and lead to 3^e(k) * U + c(k).
+// there are only w + 1 exponents e(k), so the offsets are grouped by them and
+// 3^e * U is computed once per group. the members of a group are then checked
+// by checker_dispatch from 3^e * U + c(k), in parallel.
+namespace neighborhood_sweep {
+
+// the offsets have to fit into a window of at most this many bits, so that
+// c(k) < 3^MAX_WINDOW_BITS fits into a limb
+const size_t MAX_WINDOW_BITS = 32;
+
+struct options {
+	size_t thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+};
+
+// the first window steps of an offset k < 2^window, which map
+// U * 2^window + k to 3^exponent * U + carry
+struct first_steps {
+	size_t exponent = 0;
+	dbl_limb_t carry = 0;
+
+	first_steps(uint64_t k, size_t window);
+};
+
+struct member_result {
+	uint64_t step_count_evn = 0;
+	uint64_t step_count_odd = 0;
+};
+
+struct sweep_result {
+	// the step counts of base + k at index k, including the first steps
+	std::vector<member_result> members;
+
+	size_t window = 0;
+
+	// the number of distinct exponents, each with one big multiplication
+	size_t group_count = 0;
+};
+
+sweep_result run(const mpz_class &base, uint64_t offset_count, const options &opts);
+
+// the step counts as csv lines "k,step_count_evn,step_count_odd" after a
+// header line
+void write_csv(const sweep_result &r, std::ostream &out);
+
+} /* namespace neighborhood_sweep */
+
+#endif /* NEIGHBORHOOD_SWEEP_H_ */
@@ -0,0 +1,186 @@
+#include "parallel_mul.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "thread_pool.h"
+
+using std::vector;
+
+namespace parallel_mul {
+
+static config current_config;
+
+static std::unique_ptr<thread_pool> pool;
+
+// the partial products and block carries, kept for the next call
+static std::mutex scratch_mutex;
+static vector<mp_limb_t> scratch;
+static vector<mp_limb_t> carries;
+
+void configure(const config &c) {
+	if (c.min_piece_limbs == 0) {
+		throw std::runtime_error("the pieces of parallel multiplications need at least 1 limb");
+	}
+
+	current_config = c;
+
+	if (c.thread_count > 1) {
+		pool.reset(new thread_pool(c.thread_count));
+	} else {
+		pool.reset();
+	}
+}
+
+const config& get_config() {
+	return current_config;
+}
+
+// a piece of the product at pos, which has its limbs in scratch at offset
+struct partial {
+	size_t pos;
+	size_t size;
+	size_t offset;
+};
+
+// adds carry at rp[pos] and stops where it runs out
+static void propagate(mp_limb_t *rp, size_t pos, size_t n, mp_limb_t carry) {
+	for (; carry != 0 && pos < n; pos++) {
+		rp[pos] += carry;
+		carry = rp[pos] < carry;
+	}
+}
+
+void mul(mp_limb_t *rp, const mp_limb_t *ap, size_t an, const mp_limb_t *bp, size_t bn) {
+	const config &c = current_config;
+
+	if (!pool || bn < c.cutover_limbs) {
+		mpn_mul(rp, ap, an, bp, bn);
+		return;
+	}
+
+	// b is split only as far as needed to keep the pieces about square, as
+	// thinner pieces add work: t slices of a by all of b do about t times
+	// the work of one mpn_mul() for balanced operands, k*k square pieces k
+	// times. from an >= thread_count * bn / 2 on only a is split.
+	size_t b_count = (size_t) std::lround(std::sqrt((double) c.thread_count * bn / an));
+	b_count = std::max((size_t) 1, std::min(b_count, bn / c.min_piece_limbs));
+
+	size_t a_count = std::min(c.thread_count / b_count, std::max((size_t) 1, an / c.min_piece_limbs));
+
+	if (a_count * b_count <= 1) {
+		mpn_mul(rp, ap, an, bp, bn);
+		return;
+	}
+
+	size_t a_piece = (an + a_count - 1) / a_count;
+	size_t b_piece = (bn + b_count - 1) / b_count;
+	a_count = (an + a_piece - 1) / a_piece;
+	b_count = (bn + b_piece - 1) / b_piece;
+
+	vector<partial> parts(a_count * b_count);
+	size_t offset = 0;
+	for (size_t task = 0; task < parts.size(); task++) {
+		size_t i = task / b_count;
+		size_t j = task % b_count;
+
+		parts[task].pos = i * a_piece + j * b_piece;
+		parts[task].size = std::min(a_piece, an - i * a_piece) + std::min(b_piece, bn - j * b_piece);
+		parts[task].offset = offset;
+		offset += parts[task].size;
+	}
+
+	size_t rn = an + bn;
+	size_t block_count = pool->size();
+	size_t block = (rn + block_count - 1) / block_count;
+
+	std::lock_guard<std::mutex> lock(scratch_mutex);
+
+	if (scratch.size() < offset) {
+		scratch.resize(offset);
+	}
+
+	carries.assign(block_count, 0);
+
+	pool->run(parts.size(), [&](size_t task) {
+		size_t i = task / b_count;
+		size_t j = task % b_count;
+
+		const mp_limb_t *ai = ap + i * a_piece;
+		const mp_limb_t *bj = bp + j * b_piece;
+		size_t ain = std::min(a_piece, an - i * a_piece);
+		size_t bjn = std::min(b_piece, bn - j * b_piece);
+
+		mp_limb_t *p = scratch.data() + parts[task].offset;
+
+		if (ain >= bjn) {
+			mpn_mul(p, ai, ain, bj, bjn);
+		} else {
+			mpn_mul(p, bj, bjn, ai, ain);
+		}
+	});
+
+	// each block of the product sums the parts of the pieces within it, with
+	// the carry out of its top kept for the pass below
+	pool->run(block_count, [&](size_t b) {
+		size_t lo = std::min(rn, b * block);
+		size_t hi = std::min(rn, lo + block);
+
+		std::fill(rp + lo, rp + hi, 0);
+
+		for (const partial &part : parts) {
+			size_t from = std::max(lo, part.pos);
+			size_t to = std::min(hi, part.pos + part.size);
+
+			if (from >= to) {
+				continue;
+			}
+
+			const mp_limb_t *p = scratch.data() + part.offset + (from - part.pos);
+			mp_limb_t carry = mpn_add_n(rp + from, rp + from, p, to - from);
+
+			if (carry != 0 && to < hi) {
+				carry = mpn_add_1(rp + to, rp + to, hi - to, carry);
+			}
+
+			carries[b] += carry;
+		}
+	});
+
+	for (size_t b = 0; b < block_count; b++) {
+		propagate(rp, std::min(rn, (b + 1) * block), rn, carries[b]);
+	}
+}
+
+void mul(mpz_class &value, mpz_srcptr factor) {
+	size_t vn = mpz_size(value.get_mpz_t());
+	size_t fn = mpz_size(factor);
+
+	if (!pool || std::min(vn, fn) < current_config.cutover_limbs) {
+		mpz_mul(value.get_mpz_t(), value.get_mpz_t(), factor);
+		return;
+	}
+
+	mpz_class product;
+	mp_limb_t *rp = mpz_limbs_write(product.get_mpz_t(), vn + fn);
+
+	if (vn >= fn) {
+		mul(rp, mpz_limbs_read(value.get_mpz_t()), vn, mpz_limbs_read(factor), fn);
+	} else {
+		mul(rp, mpz_limbs_read(factor), fn, mpz_limbs_read(value.get_mpz_t()), vn);
+	}
+
+	mpz_limbs_finish(product.get_mpz_t(), vn + fn);
+
+	if (mpz_sgn(value.get_mpz_t()) * mpz_sgn(factor) < 0) {
+		mpz_neg(product.get_mpz_t(), product.get_mpz_t());
+	}
+
+	mpz_swap(value.get_mpz_t(), product.get_mpz_t());
+}
+
+} /* namespace parallel_mul */
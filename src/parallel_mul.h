@@ -0,0 +1,49 @@
+#ifndef PARALLEL_MUL_H_
+#define PARALLEL_MUL_H_
+
+#include <gmp.h>
+#include <gmpxx.h>
+#include <stddef.h>
+
+// multiplication of big numbers on several threads.
+//
+// above a size threshold, the longer operand is split into up to
+// thread_count slices, which are multiplied by the other operand by mpn_mul()
+// on a thread pool. while the slices are at least as long as the other
+// operand, this is about the work of one mpn_mul(). closer to balanced
+// operands, the shorter one is split as well, into k*k about square pieces
+// with k times the work of one mpn_mul(), which is still less than the t
+// times of t thin slices.
+//
+// the products go to scratch space, which is kept for the next call. each
+// thread then adds up the parts within one block of the result, and a single
+// pass propagates the carries between the blocks.
+namespace parallel_mul {
+
+struct config {
+	// 1 disables parallel multiplication
+	size_t thread_count = 1;
+
+	// products with a smaller operand below this many limbs are computed by a
+	// single mpn_mul()
+	size_t cutover_limbs = 1 << 14;
+
+	// operands are not split into pieces smaller than this many limbs
+	size_t min_piece_limbs = 1 << 12;
+};
+
+// not thread safe, call it before starting any other threads
+void configure(const config &c);
+
+const config& get_config();
+
+// rp[0, an + bn) = ap[0, an) * bp[0, bn). requires an >= bn >= 1 and rp not
+// overlapping with the operands, like mpn_mul().
+void mul(mp_limb_t *rp, const mp_limb_t *ap, size_t an, const mp_limb_t *bp, size_t bn);
+
+// value *= factor
+void mul(mpz_class &value, mpz_srcptr factor);
+
+} /* namespace parallel_mul */
+
+#endif /* PARALLEL_MUL_H_ */
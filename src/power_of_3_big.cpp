@@ -1,23 +1,293 @@
 #include "power_of_3_big.h"
 
 #include <gmp.h>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
 
-using std::vector;
+using std::string;
 
 namespace power_of_3_big {
 
-vector<mpz_class> create() {
-	vector<mpz_class> t(LOOKUP_TABLE_INITIAL_SIZE);
+static std::atomic<size_t> default_memory_budget(DEFAULT_MEMORY_BUDGET);
 
-	t[0] = 1;
+void set_default_memory_budget(size_t memory_budget) {
+	default_memory_budget = memory_budget;
+}
+
+size_t get_default_memory_budget() {
+	return default_memory_budget;
+}
+
+void write_table_file(const string &path, size_t entry_count) {
+	std::ofstream out = table_file::create(path, TABLE_FILE_KIND);
+
+	// the data starts after the index
+	table_file::header header = table_file::make_header(TABLE_FILE_MAGIC, TABLE_FILE_VERSION, sizeof(mp_limb_t),
+			entry_count, (entry_count + 1) * sizeof(uint64_t));
+
+	std::vector<uint64_t> index(entry_count + 1);
+
+	out.seekp(header.data_offset);
+
+	mpz_class pow3 = 1;
+	for (size_t i = 0; i < entry_count; i++) {
+		size_t n = mpz_size(pow3.get_mpz_t());
+
+		out.write(reinterpret_cast<const char*>(mpz_limbs_read(pow3.get_mpz_t())), n * sizeof(mp_limb_t));
+
+		index[i + 1] = index[i] + n;
+
+		pow3 *= 3;
+	}
+
+	table_file::write_header(out, header);
+	out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(uint64_t));
+
+	table_file::finish(out, path);
+}
+
+void mapped_table::open(const string &path) {
+	file.open(path);
+
+	table_file::header header = table_file::read_header(file, TABLE_FILE_MAGIC, TABLE_FILE_VERSION, TABLE_FILE_KIND);
+
+	if (header.param != sizeof(mp_limb_t)) {
+		table_file::unsupported(file, TABLE_FILE_KIND, "limb_size=" + std::to_string(header.param));
+	}
+
+	// the index lies between the header and the data, which read_header()
+	// checked to start behind the header
+	if ((header.data_offset - sizeof(header)) / sizeof(uint64_t) <= header.entry_count) {
+		throw std::runtime_error("truncated " + string(TABLE_FILE_KIND) + " file " + path);
+	}
+
+	index = reinterpret_cast<const uint64_t*>(file.begin() + sizeof(header));
+	limbs = reinterpret_cast<const mp_limb_t*>(file.begin() + header.data_offset);
+
+	// view() trusts the index, so that all powers have to lie within the data
+	if (index[0] != 0) {
+		table_file::unsupported(file, TABLE_FILE_KIND, "offset[0]=" + std::to_string(index[0]));
+	}
+
+	for (uint64_t i = 0; i < header.entry_count; i++) {
+		if (index[i + 1] < index[i]) {
+			table_file::unsupported(file, TABLE_FILE_KIND, "offset[" + std::to_string(i + 1) + "] decreasing");
+		}
+	}
+
+	table_file::ensure_data(file, header, index[header.entry_count], sizeof(mp_limb_t), TABLE_FILE_KIND);
+
+	entry_count = header.entry_count;
+}
+
+static mapped_table attached;
+
+void attach_table_file(const string &path) {
+	attached.open(path);
+}
+
+const mapped_table& attached_table() {
+	return attached;
+}
+
+string cache::statistics::str() const {
+	std::ostringstream os;
+
+	os << "pow3_cache[" //
+			<< "hits=" << hit_count //
+			<< " misses=" << miss_count //
+			<< " evictions=" << eviction_count //
+			<< " memory=" << memory_used //
+			<< "]";
+
+	return os.str();
+}
+
+cache::cache(size_t memory_budget) :
+		memory_budget(memory_budget) {
+	dense.reserve(DENSE_SIZE);
+	dense.push_back(1);
+}
+
+void cache::set_memory_budget(size_t memory_budget) {
+	this->memory_budget = memory_budget;
+
+	evict(0);
+}
+
+void cache::clear() {
+	anchors.clear();
+	exact.clear();
+	lru.clear();
+
+	stat.memory_used = 0;
+	for (const auto &d : dense) {
+		stat.memory_used += memory_of(d);
+	}
+}
+
+// clears all but the highest 2 set bits of exponent, so that the remainder is
+// less than half of the result
+size_t cache::anchor_exponent(size_t exponent) {
+	size_t k = 63 - __builtin_clzll(exponent);
 
-	for (size_t i = 1; i < t.size(); i++) {
-		mpz_mul_ui(t[i].get_mpz_t(), t[i - 1].get_mpz_t(), 3);
+	size_t result = ((size_t) 1) << k;
+
+	if (k > 0) {
+		result |= exponent & (((size_t) 1) << (k - 1));
+	}
+
+	return result;
+}
+
+const mpz_class& cache::get_dense(size_t exponent) {
+	while (dense.size() <= exponent) {
+		dense.push_back(dense.back() * 3);
+		stat.memory_used += memory_of(dense.back());
+	}
+
+	return dense[exponent];
+}
+
+const mpz_class& cache::get_anchor(size_t exponent) {
+	if (exponent < DENSE_SIZE) {
+		return get_dense(exponent);
+	}
+
+	auto it = anchors.find(exponent);
+	if (it != anchors.end()) {
+		return it->second;
+	}
+
+	mpz_class value;
+
+	size_t half = exponent >> 1;
+	if ((exponent & (exponent - 1)) == 0) {
+		// 3^(2^k) = (3^(2^(k-1)))^2
+		const mpz_class &h = get_anchor(half);
+		mpz_mul(value.get_mpz_t(), h.get_mpz_t(), h.get_mpz_t());
+	} else {
+		// 3^(3*2^(k-1)) = 3^(2^k) * 3^(2^(k-1))
+		size_t lo = anchor_exponent(exponent) ^ (((size_t) 1) << (63 - __builtin_clzll(exponent)));
+		const mpz_class &h = get_anchor(exponent - lo);
+		const mpz_class &l = get_anchor(lo);
+		mpz_mul(value.get_mpz_t(), h.get_mpz_t(), l.get_mpz_t());
+	}
+
+	stat.memory_used += memory_of(value);
+
+	return anchors.emplace(exponent, std::move(value)).first->second;
+}
+
+mpz_srcptr cache::get(size_t exponent) {
+	if (exponent < DENSE_SIZE) {
+		if (exponent < dense.size()) {
+			stat.hit_count++;
+		} else {
+			stat.miss_count++;
+		}
+
+		return get_dense(exponent).get_mpz_t();
+	}
+
+	if (exponent < attached.size()) {
+		stat.hit_count++;
+		attached.view(exponent, mapped_view);
+		return mapped_view;
+	}
+
+	auto exact_it = exact.find(exponent);
+	if (exact_it != exact.end()) {
+		stat.hit_count++;
+		lru.splice(lru.begin(), lru, exact_it->second.lru_pos);
+		return exact_it->second.value.get_mpz_t();
 	}
 
-	return t;
+	size_t anchor_1 = anchor_exponent(exponent);
+	size_t remainder_1 = exponent - anchor_1;
+
+	if (remainder_1 == 0) {
+		if (anchors.count(exponent) != 0) {
+			stat.hit_count++;
+		} else {
+			stat.miss_count++;
+		}
+
+		mpz_srcptr result = get_anchor(exponent).get_mpz_t();
+		evict(exponent);
+		return result;
+	}
+
+	stat.miss_count++;
+
+	exact_entry &e = exact[exponent];
+
+	if (remainder_1 < DENSE_SIZE) {
+		mpz_mul(e.value.get_mpz_t(), get_anchor(anchor_1).get_mpz_t(), get_dense(remainder_1).get_mpz_t());
+	} else {
+		size_t anchor_2 = anchor_exponent(remainder_1);
+		size_t remainder_2 = remainder_1 - anchor_2;
+
+		mpz_mul(e.value.get_mpz_t(), get_anchor(anchor_1).get_mpz_t(), get_anchor(anchor_2).get_mpz_t());
+
+		if (remainder_2 < DENSE_SIZE) {
+			e.value *= get_dense(remainder_2);
+		} else {
+			e.value *= calculate(remainder_2);
+		}
+	}
+
+	lru.push_front(exponent);
+	e.lru_pos = lru.begin();
+
+	stat.memory_used += memory_of(e.value);
+
+	mpz_srcptr result = e.value.get_mpz_t();
+
+	evict(exponent);
+
+	return result;
+}
+
+// evicts until the memory budget is met, but never the entry for
+// keep_exponent and never the dense table
+void cache::evict(size_t keep_exponent) {
+	while (stat.memory_used > memory_budget && !lru.empty()) {
+		size_t victim = lru.back();
+		if (victim == keep_exponent) {
+			break;
+		}
+
+		auto it = exact.find(victim);
+		stat.memory_used -= memory_of(it->second.value);
+		exact.erase(it);
+		lru.pop_back();
+
+		stat.eviction_count++;
+	}
+
+	while (stat.memory_used > memory_budget && !anchors.empty()) {
+		auto it = std::prev(anchors.end());
+		if (it->first == keep_exponent) {
+			if (it == anchors.begin()) {
+				break;
+			}
+			it = std::prev(it);
+		}
+
+		stat.memory_used -= memory_of(it->second);
+		anchors.erase(it);
+
+		stat.eviction_count++;
+	}
 }
 
-vector<mpz_class> LOOKUP_TABLE = create();
+cache& thread_cache() {
+	thread_local cache c;
+	return c;
+}
 
 } /* namespace power_of_3_big */
@@ -1,16 +1,20 @@
 #ifndef POWER_OF_3_BIG_H_
 #define POWER_OF_3_BIG_H_
 
+#include <gmp.h>
 #include <gmpxx.h>
 #include <stddef.h>
-#include <memory>
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
-namespace power_of_3_big {
-
-extern std::vector<mpz_class> LOOKUP_TABLE;
+#include "mapped_file.h"
+#include "table_file.h"
 
-const size_t LOOKUP_TABLE_INITIAL_SIZE = (1 << 17) + 1;
+namespace power_of_3_big {
 
 inline mpz_class calculate(size_t exponent) {
 	mpz_class pow3;
@@ -20,6 +24,150 @@ inline mpz_class calculate(size_t exponent) {
 	return pow3;
 }
 
+// powers with exponents below this are held in a dense table
+const size_t DENSE_SIZE = 1 << 11;
+
+// a binary file holding 3^0..3^(entry_count-1), written once by
+// write_table_file() and mapped read-only by any number of processes.
+//
+// layout: a table_file::header with the limb size as param, then
+// entry_count+1 offsets (uint64_t, in limbs, relative to data_offset), then
+// the little-endian limbs of all powers back to back. 3^i occupies the limbs
+// [offset[i], offset[i+1]).
+const char TABLE_FILE_MAGIC[8] = { 'C', 'O', 'L', 'P', 'O', 'W', '3', '\0' };
+const uint32_t TABLE_FILE_VERSION = 1;
+const char TABLE_FILE_KIND[] = "power of 3 table";
+
+void write_table_file(const std::string &path, size_t entry_count);
+
+class mapped_table {
+public:
+	void open(const std::string &path);
+
+	bool is_open() const {
+		return file.is_open();
+	}
+
+	size_t size() const {
+		return entry_count;
+	}
+
+	// points view to the mapped limbs of 3^exponent without copying them. view
+	// is read-only and must not be cleared.
+	void view(size_t exponent, mpz_t view) const {
+		mpz_roinit_n(view, limbs + index[exponent], index[exponent + 1] - index[exponent]);
+	}
+
+private:
+	mapped_file file;
+	const uint64_t *index = nullptr;
+	const mp_limb_t *limbs = nullptr;
+	size_t entry_count = 0;
+};
+
+// maps the table file at path for all caches of this process. not thread
+// safe, call it before starting any threads.
+void attach_table_file(const std::string &path);
+
+const mapped_table& attached_table();
+
+const size_t DEFAULT_MEMORY_BUDGET = ((size_t) 256) << 20;
+
+// memory budget in bytes for caches constructed without an explicit budget,
+// e.g. the one of thread_cache()
+void set_default_memory_budget(size_t memory_budget);
+size_t get_default_memory_budget();
+
+// a lazily populated cache of powers of 3.
+//
+// exponents below DENSE_SIZE are kept in a dense table. exponents covered by
+// the attached table file are served from there. any other exponent e
+// is built from at most two anchors of the form 3^(2^k) or 3^(3*2^(k-1)),
+// which are the top one or two set bits of e (and of its remainder), and a
+// dense entry or a direct calculation for what's left. anchors and built
+// powers are kept until the memory budget forces their eviction, least
+// recently used built powers first, then the largest anchors.
+//
+// this class is not thread safe. use one instance per thread, e.g. via
+// thread_cache().
+class cache {
+public:
+	struct statistics {
+		size_t hit_count = 0;
+		size_t miss_count = 0;
+		size_t eviction_count = 0;
+		size_t memory_used = 0;
+
+		std::string str() const;
+	};
+
+	explicit cache(size_t memory_budget = get_default_memory_budget());
+
+	// returns 3^exponent. the result is valid until the next call to get() on
+	// this instance.
+	mpz_srcptr get(size_t exponent);
+
+	void set_memory_budget(size_t memory_budget);
+
+	size_t get_memory_budget() const {
+		return memory_budget;
+	}
+
+	const statistics& stats() const {
+		return stat;
+	}
+
+	// drops everything except the dense table
+	void clear();
+
+private:
+	struct exact_entry {
+		mpz_class value;
+		std::list<size_t>::iterator lru_pos;
+	};
+
+	size_t memory_budget;
+	statistics stat;
+
+	mpz_t mapped_view;
+
+	std::vector<mpz_class> dense;
+	std::map<size_t, mpz_class> anchors;
+	std::unordered_map<size_t, exact_entry> exact;
+
+	// exponents in exact, most recently used first
+	std::list<size_t> lru;
+
+	static size_t anchor_exponent(size_t exponent);
+
+	static size_t memory_of(const mpz_class &v) {
+		return mpz_size(v.get_mpz_t()) * sizeof(mp_limb_t);
+	}
+
+	const mpz_class& get_dense(size_t exponent);
+	const mpz_class& get_anchor(size_t exponent);
+
+	void evict(size_t keep_exponent);
+};
+
+// the cache of the calling thread
+cache& thread_cache();
+
+// returns 3^exponent from the cache of the calling thread. the result is
+// valid until the next lookup in the same thread.
+inline mpz_srcptr lookup(size_t exponent) {
+	return thread_cache().get(exponent);
+}
+
+// value *= 3^exponent
+inline void multiply(mpz_class &value, size_t exponent) {
+	if (exponent == 0) {
+		return;
+	}
+
+	mpz_mul(value.get_mpz_t(), value.get_mpz_t(), lookup(exponent));
+}
+
 } /* namespace power_of_3_big */
 
 #endif /* POWER_OF_3_BIG_H_ */
@@ -0,0 +1,132 @@
+#include "progress_reporter.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "amount_formatter.h"
+
+using std::string;
+
+namespace amf = amount_formatter;
+namespace ela = elapsed_time;
+
+progress_reporter::progress_reporter(const progress_counters &counters, std::ostream *out, const string &status_path,
+		ela::elapsed_time_ns interval) :
+		counters(counters), out(out), status_path(status_path), interval(interval) {
+	start_time = ela::steady_time();
+	last_time = start_time;
+
+	thread = std::thread(&progress_reporter::reporter_loop, this);
+}
+
+progress_reporter::~progress_reporter() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	changed.notify_all();
+	thread.join();
+
+	try {
+		write_status(report(true));
+	} catch (const std::exception&) {
+		// a destructor must not throw, and the check itself is done
+	}
+}
+
+ela::elapsed_time_ns progress_reporter::eta(uint64_t bitlen, double step_count_evn_per_s) {
+	const double LOG_BASE2_OF_3 = 1.58496250072115618145;
+	const double BITS_PER_STEP_EVN = 1 - LOG_BASE2_OF_3 / 2;
+
+	if (step_count_evn_per_s <= 0) {
+		return -1;
+	}
+
+	return (ela::elapsed_time_ns) (bitlen / BITS_PER_STEP_EVN / step_count_evn_per_s * ela::NS_PER_SEC);
+}
+
+string progress_reporter::report(bool done) {
+	ela::elapsed_time_ns now = ela::steady_time();
+
+	uint64_t step_count_evn = counters.step_count_evn.load(std::memory_order_relaxed);
+	uint64_t step_count_odd = counters.step_count_odd.load(std::memory_order_relaxed);
+	uint64_t bitlen = counters.bitlen.load(std::memory_order_relaxed);
+
+	// the rate of the last interval, as the value shrinks over time
+	double seconds = (now - last_time) / (double) ela::NS_PER_SEC;
+	double step_count_evn_per_s = seconds > 0 ? (step_count_evn - last_step_count_evn) / seconds : 0;
+	double step_count_per_s = seconds > 0 ? (step_count_evn + step_count_odd - last_step_count) / seconds : 0;
+
+	last_time = now;
+	last_step_count_evn = step_count_evn;
+	last_step_count = step_count_evn + step_count_odd;
+
+	std::ostringstream os;
+
+	os << "" //
+			<< "iterations " << amf::format_metric(counters.iter_count.load(std::memory_order_relaxed)) //
+			<< ", steps " << amf::format_metric(step_count_evn + step_count_odd) //
+			<< " at " << amf::format_metric((long long) step_count_per_s) << "/s" //
+			<< ", bitlen " << amf::format_metric(bitlen) //
+			<< ", limbs " << amf::format_metric(counters.limb_count.load(std::memory_order_relaxed)) //
+			<< ", elapsed " << ela::format_dura(now - start_time) //
+			;
+
+	ela::elapsed_time_ns remaining = eta(bitlen, step_count_evn_per_s);
+
+	if (done) {
+		os << ", done";
+	} else if (remaining >= 0) {
+		os << ", eta " << ela::format_dura(remaining);
+	}
+
+	return os.str();
+}
+
+void progress_reporter::write_status(const string &line) {
+	if (status_path.empty()) {
+		return;
+	}
+
+	string tmp_path = status_path + ".tmp";
+
+	std::ofstream status(tmp_path);
+	status << line << "\n";
+
+	if (!status.flush()) {
+		throw std::runtime_error("cannot write " + tmp_path);
+	}
+
+	status.close();
+
+	if (std::rename(tmp_path.c_str(), status_path.c_str()) != 0) {
+		throw std::runtime_error("cannot rename to " + status_path);
+	}
+}
+
+void progress_reporter::reporter_loop() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (!changed.wait_for(lock, std::chrono::nanoseconds(interval), [&] {
+		return stopping;
+	})) {
+		string line = report(false);
+
+		if (out != nullptr) {
+			*out << "progress: " << line << "\n" << std::flush;
+		}
+
+		try {
+			write_status(line);
+		} catch (const std::exception &e) {
+			// the check goes on without a status file
+			if (out != nullptr) {
+				*out << "progress: " << e.what() << "\n" << std::flush;
+			}
+			status_path.clear();
+		}
+	}
+}
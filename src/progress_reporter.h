@@ -0,0 +1,87 @@
+#ifndef PROGRESS_REPORTER_H_
+#define PROGRESS_REPORTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "elapsed_time.h"
+
+// counters a checker publishes during complete_check() for a
+// progress_reporter in another thread. the checker stores them with relaxed
+// atomics only every PUBLISH_STRIDE iterations, so iterate() is untouched.
+struct progress_counters {
+	static const size_t PUBLISH_STRIDE = 1024;
+
+	std::atomic<uint64_t> step_count_evn { 0 };
+	std::atomic<uint64_t> step_count_odd { 0 };
+	std::atomic<uint64_t> iter_count { 0 };
+
+	// limbs of the value, for the fast checker summed over the accu_chain
+	std::atomic<uint64_t> limb_count { 0 };
+
+	// bit length of the value, for the fast checker a lower bound
+	std::atomic<uint64_t> bitlen { 0 };
+
+	inline void publish(uint64_t evn, uint64_t odd, uint64_t iter, uint64_t limbs, uint64_t bits) {
+		step_count_evn.store(evn, std::memory_order_relaxed);
+		step_count_odd.store(odd, std::memory_order_relaxed);
+		iter_count.store(iter, std::memory_order_relaxed);
+		limb_count.store(limbs, std::memory_order_relaxed);
+		bitlen.store(bits, std::memory_order_relaxed);
+	}
+};
+
+// samples progress_counters every interval and writes a line with the rates
+// and an eta to out and to the status file, which is replaced by renaming,
+// so that it can be read at any time. either may be left out.
+//
+// the eta assumes the average drift of a random value: every step that halves
+// takes a bit, and about every second one comes with a step that multiplies
+// by 3, which adds log2(3) bits. so the value loses 1 - log2(3)/2 bits per
+// halving step, at the rate of halving steps of the last interval.
+class progress_reporter {
+public:
+	progress_reporter(const progress_counters &counters, std::ostream *out, const std::string &status_path,
+			elapsed_time::elapsed_time_ns interval);
+
+	// writes a last status file
+	~progress_reporter();
+
+	progress_reporter(const progress_reporter&) = delete;
+	progress_reporter& operator=(const progress_reporter&) = delete;
+
+	// the expected time until a value of bitlen bits reaches 1, at
+	// step_count_evn_per_s halving steps per second
+	static elapsed_time::elapsed_time_ns eta(uint64_t bitlen, double step_count_evn_per_s);
+
+private:
+	const progress_counters &counters;
+	std::ostream *out;
+	std::string status_path;
+	elapsed_time::elapsed_time_ns interval;
+
+	elapsed_time::elapsed_time_ns start_time;
+	elapsed_time::elapsed_time_ns last_time;
+	uint64_t last_step_count_evn = 0;
+	uint64_t last_step_count = 0;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	bool stopping = false;
+
+	std::thread thread;
+
+	std::string report(bool done);
+
+	void write_status(const std::string &line);
+
+	void reporter_loop();
+};
+
+#endif /* PROGRESS_REPORTER_H_ */
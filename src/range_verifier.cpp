@@ -0,0 +1,131 @@
+#include "range_verifier.h"
+
+#include <filesystem>
+#include <sstream>
+
+using std::string;
+
+namespace range_verifier {
+
+void chunk_result::merge(const chunk_result &other) {
+	skipped_count += other.skipped_count;
+
+	if (other.checked_count == 0) {
+		return;
+	}
+
+	bool other_is_max = checked_count == 0 || other.max_steps > max_steps
+			|| (other.max_steps == max_steps && other.max_steps_witness < max_steps_witness);
+
+	if (other_is_max) {
+		max_steps = other.max_steps;
+		max_steps_witness = other.max_steps_witness;
+	}
+
+	checked_count += other.checked_count;
+	total_steps += other.total_steps;
+}
+
+size_t get_chunk_count(const mpz_class &begin, const mpz_class &end, uint64_t chunk_size) {
+	if (end <= begin) {
+		return 0;
+	}
+
+	mpz_class count = (end - begin + chunk_size - 1) / chunk_size;
+
+	if (!count.fits_ulong_p()) {
+		throw std::runtime_error("too many chunks, use a larger chunk size");
+	}
+
+	return count.get_ui();
+}
+
+static string header_line(const mpz_class &begin, const mpz_class &end, const options &opts) {
+	std::ostringstream os;
+	os << "range " << begin << " " << end << " " << opts.chunk_size << " sieve=" << opts.sieve_bits << " mod3="
+			<< opts.mod3_filter << " glide=" << opts.stop_below_start;
+	return os.str();
+}
+
+checkpoint::checkpoint(const mpz_class &begin, const mpz_class &end, const options &opts) :
+		path(opts.checkpoint_path) {
+	if (path.empty()) {
+		return;
+	}
+
+	string header = header_line(begin, end, opts);
+
+	bool exists = false;
+
+	// end of the last complete line
+	std::streamoff complete_size = 0;
+	bool cut_off = false;
+	{
+		std::ifstream in(path);
+		string line;
+
+		// a file without a complete header line is started over
+		cut_off = bool(in);
+
+		if (in && std::getline(in, line) && !in.eof()) {
+			exists = true;
+
+			if (line != header) {
+				throw std::runtime_error("checkpoint file " + path + " belongs to a different range: " + line);
+			}
+
+			complete_size = in.tellg();
+			cut_off = false;
+
+			while (std::getline(in, line)) {
+				// a line cut off by a crash has no trailing newline. it is
+				// dropped and its chunk is simply checked again.
+				if (in.eof()) {
+					cut_off = true;
+					break;
+				}
+
+				complete_size = in.tellg();
+
+				std::istringstream is(line);
+
+				size_t chunk_idx;
+				chunk_result r;
+				string witness;
+
+				if (is >> chunk_idx >> r.checked_count >> r.skipped_count >> r.total_steps >> r.max_steps >> witness) {
+					r.max_steps_witness = witness;
+					completed_chunks[chunk_idx] = r;
+				}
+			}
+		}
+	}
+
+	if (cut_off) {
+		std::filesystem::resize_file(path, complete_size);
+	}
+
+	out.open(path, std::ios::app);
+	if (!out) {
+		throw std::runtime_error("cannot open checkpoint file " + path);
+	}
+
+	if (!exists) {
+		out << header << "\n" << std::flush;
+	}
+}
+
+void checkpoint::append(size_t chunk_idx, const chunk_result &result) {
+	if (path.empty()) {
+		return;
+	}
+
+	std::ostringstream os;
+	os << chunk_idx << " " << result.checked_count << " " << result.skipped_count << " " << result.total_steps << " " << result.max_steps << " "
+			<< result.max_steps_witness << "\n";
+
+	std::lock_guard<std::mutex> lock(mutex);
+	out << os.str() << std::flush;
+}
+
+} /* namespace range_verifier */
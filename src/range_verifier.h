@@ -0,0 +1,319 @@
+#ifndef RANGE_VERIFIER_H_
+#define RANGE_VERIFIER_H_
+
+#include <gmpxx.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "collatz_batch.h"
+#include "residue_sieve.h"
+#include "work_stealing_queue.h"
+
+// exhaustive verification of all start values in a range [begin, end). the
+// range is split into chunks, which are checked by a work stealing thread
+// pool with one reused checker per thread.
+namespace range_verifier {
+
+struct options {
+	size_t thread_count = 1;
+
+	uint64_t chunk_size = 1 << 16;
+
+	// start values n >= 2^sieve_bits whose residue mod 2^sieve_bits is not in
+	// the residue_sieve are skipped, 0 disables the sieve. like mod3_filter,
+	// this relies on all values below the range being verified already.
+	size_t sieve_bits = 24;
+
+	// skip start values n = 2 (mod 3), see has_smaller_predecessor()
+	bool mod3_filter = true;
+
+	// check start values only until they drop below themselves, which proves
+	// them as well if all smaller values converge. the step counts are those
+	// of the glides then.
+	bool stop_below_start = false;
+
+	// check start values below 2^64 with collatz_batch instead of the checker,
+	// except with stop_below_start
+	bool batch = true;
+
+	// completed chunks are appended to this file. chunks it already lists are
+	// not checked again, so an interrupted run can be resumed. empty for none.
+	std::string checkpoint_path;
+};
+
+struct chunk_result {
+	uint64_t checked_count = 0;
+
+	// start values proven by the sieve or the mod 3 filter
+	uint64_t skipped_count = 0;
+
+	uint64_t total_steps = 0;
+	uint64_t max_steps = 0;
+
+	// the smallest start value with max_steps steps
+	mpz_class max_steps_witness = 0;
+
+	// START_VALUE is mpz_class or uint64_t
+	template<typename START_VALUE>
+	void add(const START_VALUE &start_value, uint64_t step_count) {
+		checked_count++;
+		total_steps += step_count;
+
+		if (step_count > max_steps || checked_count == 1) {
+			max_steps = step_count;
+			max_steps_witness = start_value;
+		}
+	}
+
+	void merge(const chunk_result &other);
+};
+
+struct range_result {
+	chunk_result total;
+
+	size_t chunk_count = 0;
+
+	// chunks taken from the checkpoint file instead of being checked
+	size_t resumed_chunk_count = 0;
+};
+
+// the checkpoint file of a range. its first line identifies the range, each
+// further line holds one completed chunk.
+class checkpoint {
+public:
+	// reads the completed chunks from opts.checkpoint_path, if it exists, and
+	// opens it for appending. an empty path disables checkpointing.
+	checkpoint(const mpz_class &begin, const mpz_class &end, const options &opts);
+
+	const std::map<size_t, chunk_result>& completed() const {
+		return completed_chunks;
+	}
+
+	// thread safe
+	void append(size_t chunk_idx, const chunk_result &result);
+
+private:
+	std::string path;
+	std::map<size_t, chunk_result> completed_chunks;
+
+	std::mutex mutex;
+	std::ofstream out;
+};
+
+size_t get_chunk_count(const mpz_class &begin, const mpz_class &end, uint64_t chunk_size);
+
+// checks start values one by one with a checker, or, for complete checks of
+// values below 2^64, in blocks with collatz_batch. the values are added to the
+// result in the order they are passed in.
+template<typename CHECKER>
+class value_checker {
+public:
+	static const size_t BATCH_SIZE = 1 << 12;
+
+	value_checker(CHECKER &checker, const options &opts, chunk_result &result) :
+			checker(checker), result(result) {
+		checker.stop_below_start = opts.stop_below_start;
+		use_batch = opts.batch && !opts.stop_below_start;
+	}
+
+	~value_checker() {
+		flush();
+	}
+
+	void check(const mpz_class &n) {
+		if (use_batch && mpz_fits_ulong_p(n.get_mpz_t())) {
+			batch.push_back(n.get_ui());
+
+			if (batch.size() == BATCH_SIZE) {
+				flush();
+			}
+
+			return;
+		}
+
+		flush();
+
+		checker.reset();
+		checker.start_value_ref() = n;
+		checker.start_value_modified();
+		checker.complete_check();
+
+		result.add(n, checker.step_count());
+	}
+
+	void flush() {
+		if (batch.empty()) {
+			return;
+		}
+
+		batch_results.resize(batch.size());
+		collatz_batch::check(batch.data(), batch.size(), batch_results.data());
+
+		for (size_t i = 0; i < batch.size(); i++) {
+			result.add(batch[i], batch_results[i].evn + batch_results[i].odd);
+		}
+
+		batch.clear();
+	}
+
+private:
+	CHECKER &checker;
+	chunk_result &result;
+
+	bool use_batch;
+
+	std::vector<uint64_t> batch;
+	std::vector<collatz_batch::step_counts> batch_results;
+};
+
+// checks the start values in [first, end) which are not skipped by sieve, if
+// any, or the mod 3 filter
+template<typename CHECKER>
+chunk_result check_chunk(CHECKER &checker, const mpz_class &first, const mpz_class &end,
+		const residue_sieve *sieve, const options &opts) {
+	chunk_result result;
+
+	bool mod3_filter = opts.mod3_filter;
+
+	value_checker<CHECKER> values(checker, opts, result);
+
+	mpz_class n = first;
+
+	// the sieve only applies from its modulus on
+	mpz_class sieve_begin = end;
+	if (sieve != nullptr && sieve->survivor_count() != 0) {
+		sieve_begin = sieve->modulus();
+	}
+
+	for (; n < end && n < sieve_begin; n++) {
+		if (!mod3_filter || !has_smaller_predecessor(mpz_fdiv_ui(n.get_mpz_t(), 3))) {
+			values.check(n);
+		}
+	}
+
+	if (n < end) {
+		// n = base + residue
+		mpz_class base;
+		mpz_tdiv_q_2exp(base.get_mpz_t(), n.get_mpz_t(), sieve->bits());
+		mpz_mul_2exp(base.get_mpz_t(), base.get_mpz_t(), sieve->bits());
+
+		mpz_class residue = n - base;
+		residue_sieve::cursor c = sieve->seek(residue.get_ui());
+
+		while (true) {
+			if (c.at_end()) {
+				mpz_add_ui(base.get_mpz_t(), base.get_mpz_t(), sieve->modulus());
+				c = sieve->seek(0);
+			}
+
+			mpz_add_ui(n.get_mpz_t(), base.get_mpz_t(), c.residue());
+			if (n >= end) {
+				break;
+			}
+
+			if (!mod3_filter || !has_smaller_predecessor(mpz_fdiv_ui(n.get_mpz_t(), 3))) {
+				values.check(n);
+			}
+
+			c.next();
+		}
+	}
+
+	values.flush();
+
+	mpz_class count = end - first;
+	result.skipped_count = count.get_ui() - result.checked_count;
+
+	return result;
+}
+
+template<typename CHECKER>
+range_result verify(const mpz_class &begin, const mpz_class &end, const options &opts) {
+	if (begin < 1) {
+		throw std::runtime_error("ranges have to start at 1 or above");
+	}
+
+	if (opts.thread_count == 0 || opts.chunk_size == 0) {
+		throw std::runtime_error("thread count and chunk size have to be positive");
+	}
+
+	range_result result;
+	result.chunk_count = get_chunk_count(begin, end, opts.chunk_size);
+
+	checkpoint cp(begin, end, opts);
+
+	std::unique_ptr<residue_sieve> sieve;
+	if (opts.sieve_bits != 0) {
+		sieve.reset(new residue_sieve(opts.sieve_bits));
+	}
+
+	std::vector<chunk_result> chunk_results(result.chunk_count);
+	std::vector<bool> done(result.chunk_count);
+
+	for (const auto &c : cp.completed()) {
+		if (c.first < result.chunk_count) {
+			chunk_results[c.first] = c.second;
+			done[c.first] = true;
+			result.resumed_chunk_count++;
+		}
+	}
+
+	size_t thread_count = opts.thread_count;
+	work_stealing_queue queue(thread_count);
+
+	std::vector<size_t> todo;
+	for (size_t i = 0; i < result.chunk_count; i++) {
+		if (!done[i]) {
+			todo.push_back(i);
+		}
+	}
+
+	for (size_t i = 0; i < todo.size(); i++) {
+		queue.push(i * thread_count / todo.size(), todo[i]);
+	}
+
+	auto work = [&](size_t worker) {
+		CHECKER checker;
+		size_t chunk_idx;
+
+		while (queue.pop(worker, chunk_idx)) {
+			mpz_class first = begin + mpz_class(chunk_idx) * opts.chunk_size;
+			mpz_class last = first + opts.chunk_size;
+			if (last > end) {
+				last = end;
+			}
+
+			chunk_results[chunk_idx] = check_chunk(checker, first, last, sieve.get(), opts);
+			cp.append(chunk_idx, chunk_results[chunk_idx]);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t worker = 1; worker < thread_count; worker++) {
+		threads.emplace_back(work, worker);
+	}
+
+	work(0);
+
+	for (auto &t : threads) {
+		t.join();
+	}
+
+	for (const auto &c : chunk_results) {
+		result.total.merge(c);
+	}
+
+	return result;
+}
+
+} /* namespace range_verifier */
+
+#endif /* RANGE_VERIFIER_H_ */
@@ -0,0 +1,221 @@
+#include "regression_suite.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include "collatz_checker_dc.h"
+#include "collatz_checker_fast.h"
+#include "collatz_checker_naive.h"
+#include "collatz_checker_slow.h"
+#include "elapsed_time.h"
+
+using std::string;
+
+namespace regression_suite {
+
+// the step counts were taken from the fast and the dc checker, which agree
+const std::vector<reference_case> REFERENCE_CASES = {
+	{ family::pow2_plus_1, 10000, 48247, 24131, true },
+	{ family::pow2_plus_1, 100000, 478838, 239020, true },
+	{ family::pow2_plus_1, 1000000, 4809361, 2403439, true },
+	{ family::pow2_plus_1, 10000000, 48180013, 24088906, false },
+
+	{ family::pow2_minus_1, 10000, 86278, 48126, true },
+	{ family::pow2_minus_1, 100000, 863323, 481603, true },
+	{ family::pow2_minus_1, 1000000, 8615753, 4805005, true },
+	{ family::pow2_minus_1, 10000000, 86365126, 48181030, false },
+
+	{ family::pow3, 6310, 48088, 24030, true },
+	{ family::pow3, 63093, 484975, 242892, true },
+	{ family::pow3, 630930, 4826108, 2414005, true },
+	{ family::pow3, 6309298, 48238475, 24125791, false },
+
+	{ family::random, 10000, 48746, 24446, true },
+	{ family::random, 100000, 483256, 241808, true },
+	{ family::random, 1000000, 4824249, 2412833, true },
+	{ family::random, 10000000, 48155292, 24073309, false },
+};
+
+// the naive checker is only run up to this bit length
+static const size_t NAIVE_MAX_BITS = 1 << 14;
+
+// short cases are warmed up and repeated up to MAX_REPS times within
+// REPEAT_TIME, and the fastest run counts
+static const size_t MAX_REPS = 20;
+static const elapsed_time::elapsed_time_ns REPEAT_TIME = elapsed_time::NS_PER_SEC / 2;
+
+string get_name(const reference_case &c) {
+	switch (c.kind) {
+	case family::pow2_plus_1:
+		return "2^" + std::to_string(c.n) + "+1";
+	case family::pow2_minus_1:
+		return "2^" + std::to_string(c.n) + "-1";
+	case family::pow3:
+		return "3^" + std::to_string(c.n);
+	case family::random:
+		return "random" + std::to_string(c.n);
+	}
+
+	throw std::runtime_error("unknown reference case family");
+}
+
+mpz_class start_value(const reference_case &c) {
+	mpz_class v;
+
+	switch (c.kind) {
+	case family::pow2_plus_1:
+		v = 1;
+		v <<= c.n;
+		v++;
+		break;
+
+	case family::pow2_minus_1:
+		v = 1;
+		v <<= c.n;
+		v--;
+		break;
+
+	case family::pow3:
+		mpz_ui_pow_ui(v.get_mpz_t(), 3, c.n);
+		break;
+
+	case family::random:
+		v = random_value(c.n, c.n);
+		break;
+	}
+
+	return v;
+}
+
+static std::map<string, elapsed_time::elapsed_time_ns> read_baseline(const string &path) {
+	std::map<string, elapsed_time::elapsed_time_ns> baseline;
+
+	std::ifstream in(path);
+	if (!in) {
+		throw std::runtime_error("cannot open baseline file " + path);
+	}
+
+	string name;
+	string checker;
+	elapsed_time::elapsed_time_ns runtime;
+
+	while (in >> name >> checker >> runtime) {
+		baseline[name + " " + checker] = runtime;
+	}
+
+	return baseline;
+}
+
+class case_runner {
+public:
+	const options &opts;
+	std::ostream &out;
+
+	std::map<string, elapsed_time::elapsed_time_ns> baseline;
+	std::ostringstream new_baseline;
+
+	size_t failure_count = 0;
+
+	case_runner(const options &opts, std::ostream &out) :
+			opts(opts), out(out) {
+	}
+
+	template<typename CHECKER>
+	void run(const reference_case &c, const mpz_class &start) {
+		CHECKER checker;
+
+		elapsed_time::elapsed_time_ns t = 0;
+		elapsed_time::elapsed_time_ns total = 0;
+
+		// the first run is a warmup if it is short
+		for (size_t rep = 0; rep <= MAX_REPS && total < REPEAT_TIME; rep++) {
+			checker = CHECKER();
+			checker.start_value_ref() = start;
+			checker.start_value_modified();
+
+			elapsed_time::elapsed_time_ns t_rep = elapsed_time::steady_time();
+			checker.complete_check();
+			t_rep = elapsed_time::steady_time() - t_rep;
+
+			t = rep <= 1 ? t_rep : std::min(t, t_rep);
+			total += t_rep;
+		}
+
+		string name = get_name(c);
+		string key = name + " " + checker.type_abbrev();
+
+		new_baseline << key << " " << t << "\n";
+
+		double steps_per_s = checker.step_count() / (t / (double) elapsed_time::NS_PER_SEC);
+
+		out << std::left << std::setw(16) << name << std::setw(7) << checker.type_abbrev() //
+				<< std::right << std::setw(10) << elapsed_time::format_dura(t) //
+				<< std::setw(14) << (uint64_t) steps_per_s << " steps/s";
+
+		bool failed = false;
+
+		if (checker.step_count_evn != c.step_count_evn || checker.step_count_odd != c.step_count_odd) {
+			out << "  WRONG step counts " << checker.step_count_evn << "/" << checker.step_count_odd << ", expected "
+					<< c.step_count_evn << "/" << c.step_count_odd;
+			failed = true;
+		}
+
+		auto it = baseline.find(key);
+		if (it != baseline.end()) {
+			double ratio = t / (double) it->second;
+
+			out << "  " << std::fixed << std::setprecision(2) << ratio << "x of baseline";
+			out.unsetf(std::ios::floatfield);
+
+			if (ratio > 1 + opts.tolerance) {
+				out << "  REGRESSION";
+				failed = true;
+			}
+		}
+
+		out << "\n" << std::flush;
+
+		failure_count += failed;
+	}
+};
+
+size_t run(const options &opts, std::ostream &out) {
+	case_runner runner(opts, out);
+
+	if (!opts.baseline_path.empty()) {
+		runner.baseline = read_baseline(opts.baseline_path);
+	}
+
+	for (const reference_case &c : REFERENCE_CASES) {
+		if (opts.quick && !c.quick) {
+			continue;
+		}
+
+		mpz_class start = start_value(c);
+
+		if (mpz_sizeinbase(start.get_mpz_t(), 2) <= NAIVE_MAX_BITS) {
+			runner.run<collatz_checker_naive>(c, start);
+		}
+
+		runner.run<collatz_checker_slow>(c, start);
+		runner.run<collatz_checker_dc>(c, start);
+		runner.run<collatz_checker_fast>(c, start);
+	}
+
+	if (!opts.write_baseline_path.empty()) {
+		std::ofstream baseline_out(opts.write_baseline_path, std::ios::trunc);
+		baseline_out << runner.new_baseline.str();
+
+		if (!baseline_out) {
+			throw std::runtime_error("cannot write baseline file " + opts.write_baseline_path);
+		}
+	}
+
+	return runner.failure_count;
+}
+
+} /* namespace regression_suite */
@@ -0,0 +1,67 @@
+#ifndef REGRESSION_SUITE_H_
+#define REGRESSION_SUITE_H_
+
+#include <gmpxx.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// large reference start values with golden step counts, run by every checker
+// that can handle them. the runtimes are compared against a baseline file
+// written by an earlier run on the same machine.
+namespace regression_suite {
+
+enum class family {
+	// 2^n + 1
+	pow2_plus_1,
+
+	// 2^n - 1, a run of n ones
+	pow2_minus_1,
+
+	// 3^n
+	pow3,
+
+	// n pseudo random bits with the top bit set
+	random
+};
+
+struct reference_case {
+	family kind;
+	size_t n;
+
+	uint64_t step_count_evn;
+	uint64_t step_count_odd;
+
+	// part of the quick suite
+	bool quick;
+};
+
+extern const std::vector<reference_case> REFERENCE_CASES;
+
+std::string get_name(const reference_case &c);
+
+mpz_class start_value(const reference_case &c);
+
+struct options {
+	// only the cases that run in seconds
+	bool quick = false;
+
+	// runtimes to compare against, lines of "case checker runtime_ns"
+	std::string baseline_path;
+
+	// where to write the runtimes of this run as a new baseline
+	std::string write_baseline_path;
+
+	// runtimes more than this fraction above the baseline are regressions
+	double tolerance = 0.25;
+};
+
+// runs the suite and reports to out. returns the number of cases with wrong
+// step counts or a runtime regression.
+size_t run(const options &opts, std::ostream &out);
+
+} /* namespace regression_suite */
+
+#endif /* REGRESSION_SUITE_H_ */
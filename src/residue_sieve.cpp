@@ -0,0 +1,168 @@
+#include "residue_sieve.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "collatz_multistep.h"
+
+residue_sieve::residue_sieve(size_t bits) :
+		bit_count(bits) {
+	if (bits > MAX_BITS) {
+		throw std::runtime_error("residue sieves are limited to 2^32");
+	}
+
+	std::vector<uint32_t> survivors;
+	collect(survivors);
+	sort(survivors);
+
+	uint64_t previous = 0;
+	for (uint32_t s : survivors) {
+		append_delta(s - previous);
+
+		if (count % INDEX_STRIDE == 0) {
+			index.push_back( { s, data.size() });
+		}
+
+		count++;
+		previous = s;
+	}
+
+	data.shrink_to_fit();
+	index.shrink_to_fit();
+}
+
+// depth first search over the residues, lifting r mod 2^j to r and r + 2^j
+// mod 2^(j+1) as long as r survives
+void residue_sieve::collect(std::vector<uint32_t> &survivors) {
+	struct node {
+		uint32_t residue;
+		uint8_t level;
+
+		// 3^e for the e odd steps among them and T^level(residue) of the
+		// shortcut map T
+		uint64_t pow3;
+		uint64_t value;
+	};
+
+	std::vector<node> stack;
+	stack.push_back( { 0, 0, 1, 0 });
+
+	while (!stack.empty()) {
+		node n = stack.back();
+		stack.pop_back();
+
+		uint64_t pow3 = n.pow3;
+		uint64_t pow2 = ((uint64_t) 1) << n.level;
+
+		if (n.level > 0 && pow3 < pow2) {
+			// 2^level * T^level(n) = 3^e * n + c for all n = residue
+			// (mod 2^level)
+			dbl_limb_t c = (((dbl_limb_t) n.value) << n.level) - ((dbl_limb_t) pow3) * n.residue;
+
+			if ((((dbl_limb_t) (pow2 - pow3)) << bit_count) > c) {
+				continue;
+			}
+		}
+
+		if (n.level == bit_count) {
+			survivors.push_back(n.residue);
+			continue;
+		}
+
+		// T^level(residue + 2^level) = T^level(residue) + 3^e
+		for (uint64_t b = 0; b < 2; b++) {
+			node lifted = n;
+			lifted.residue += b << n.level;
+			lifted.value += b * pow3;
+
+			size_t step_count_odd = 0;
+			collatz_multistep::simple_single_step<uint64_t>(lifted.value, step_count_odd);
+
+			lifted.level++;
+			lifted.pow3 *= 1 + 2 * step_count_odd;
+
+			stack.push_back(lifted);
+		}
+	}
+}
+
+// lsd radix sort in two passes of 16 bits, which is several times faster than
+// std::sort for the 4*10^7 survivors of 2^32
+void residue_sieve::sort(std::vector<uint32_t> &survivors) {
+	std::vector<uint32_t> buffer(survivors.size());
+
+	for (size_t shift = 0; shift < 32; shift += 16) {
+		std::vector<size_t> offsets((1 << 16) + 1);
+		for (uint32_t s : survivors) {
+			offsets[((s >> shift) & 0xffff) + 1]++;
+		}
+
+		for (size_t i = 1; i < offsets.size(); i++) {
+			offsets[i] += offsets[i - 1];
+		}
+
+		for (uint32_t s : survivors) {
+			buffer[offsets[(s >> shift) & 0xffff]++] = s;
+		}
+
+		survivors.swap(buffer);
+	}
+}
+
+void residue_sieve::append_delta(uint64_t delta) {
+	while (delta >= 0x80) {
+		data.push_back((uint8_t) (delta | 0x80));
+		delta >>= 7;
+	}
+
+	data.push_back((uint8_t) delta);
+}
+
+uint64_t residue_sieve::read_delta(size_t &pos) const {
+	uint64_t delta = 0;
+
+	for (size_t shift = 0;; shift += 7) {
+		uint8_t b = data[pos++];
+		delta |= ((uint64_t) (b & 0x7f)) << shift;
+
+		if (b < 0x80) {
+			return delta;
+		}
+	}
+}
+
+void residue_sieve::cursor::next() {
+	if (pos == sieve->data.size()) {
+		ended = true;
+		return;
+	}
+
+	current += sieve->read_delta(pos);
+}
+
+residue_sieve::cursor residue_sieve::seek(uint64_t residue) const {
+	cursor c;
+	c.sieve = this;
+
+	if (index.empty()) {
+		return c;
+	}
+
+	// the last index entry at or below residue, or the first one
+	auto it = std::upper_bound(index.begin(), index.end(), residue, [](uint64_t r, const index_entry &e) {
+		return r < e.residue;
+	});
+	if (it != index.begin()) {
+		--it;
+	}
+
+	c.current = it->residue;
+	c.pos = it->pos;
+	c.ended = false;
+
+	while (!c.ended && c.current < residue) {
+		c.next();
+	}
+
+	return c;
+}
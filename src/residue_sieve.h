@@ -0,0 +1,108 @@
+#ifndef RESIDUE_SIEVE_H_
+#define RESIDUE_SIEVE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// the residues r mod 2^bits whose start values n = q * 2^bits + r >= 2^bits
+// are not proven to drop below n within the first bits steps.
+//
+// the first j <= bits steps of such an n only depend on r mod 2^j and map n
+// to (3^e * n + c) / 2^j. if 3^e < 2^j and (2^j - 3^e) * 2^bits > c, the
+// result is below n for all n >= 2^bits, so n converges if all smaller values
+// do. the survivors are found layer by layer, only lifting the survivors of
+// 2^j to 2^(j+1).
+//
+// the survivors are stored as varint coded deltas in ascending order, with
+// an index entry every INDEX_STRIDE survivors. for 2^32 this is about 1% of
+// the residues in about 45MiB.
+class residue_sieve {
+public:
+	static const size_t MAX_BITS = 32;
+
+	static const size_t INDEX_STRIDE = 256;
+
+	// iterates over the survivors in ascending order
+	class cursor {
+	public:
+		bool at_end() const {
+			return ended;
+		}
+
+		uint64_t residue() const {
+			return current;
+		}
+
+		void next();
+
+	private:
+		friend class residue_sieve;
+
+		const residue_sieve *sieve = nullptr;
+
+		// position of the delta after current
+		size_t pos = 0;
+
+		uint64_t current = 0;
+		bool ended = true;
+	};
+
+	explicit residue_sieve(size_t bits);
+
+	size_t bits() const {
+		return bit_count;
+	}
+
+	uint64_t modulus() const {
+		return ((uint64_t) 1) << bit_count;
+	}
+
+	size_t survivor_count() const {
+		return count;
+	}
+
+	// bytes used by the coded survivors and the index
+	size_t memory() const {
+		return data.size() + index.size() * sizeof(index_entry);
+	}
+
+	// returns a cursor at the smallest survivor >= residue, which is at its
+	// end if there is none
+	cursor seek(uint64_t residue) const;
+
+	bool survives(uint64_t residue) const {
+		cursor c = seek(residue);
+		return !c.at_end() && c.residue() == residue;
+	}
+
+private:
+	// survivor number i * INDEX_STRIDE and the position of the delta after it
+	struct index_entry {
+		uint64_t residue;
+		size_t pos;
+	};
+
+	size_t bit_count;
+	size_t count = 0;
+
+	// the first delta is the first survivor itself
+	std::vector<uint8_t> data;
+	std::vector<index_entry> index;
+
+	void collect(std::vector<uint32_t> &survivors);
+
+	static void sort(std::vector<uint32_t> &survivors);
+
+	void append_delta(uint64_t delta);
+
+	uint64_t read_delta(size_t &pos) const;
+};
+
+// values n = 2 (mod 3) are reached from the smaller odd value (2n - 1) / 3, so
+// they converge if all smaller values do
+inline bool has_smaller_predecessor(uint64_t n_mod_3) {
+	return n_mod_3 == 2;
+}
+
+#endif /* RESIDUE_SIEVE_H_ */
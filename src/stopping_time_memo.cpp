@@ -0,0 +1,232 @@
+#include "stopping_time_memo.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "collatz_multistep.h"
+#include "mpz_utils.h"
+
+using std::string;
+
+namespace stopping_time_memo {
+
+// adds the step counts of x from entries, which hold those of all odd values
+// up to x
+static void add_below(dbl_limb_t x, const std::vector<uint32_t> &entries, size_t &step_count_evn,
+		size_t &step_count_odd) {
+	while ((x & 1) == 0) {
+		x >>= 1;
+		step_count_evn++;
+	}
+
+	uint32_t entry = entries[(size_t) (x >> 1)];
+	step_count_evn += entry & 0xFFFF;
+	step_count_odd += entry >> 16;
+}
+
+void write_table_file(const string &path, size_t bits) {
+	if (bits < MIN_TABLE_BITS || bits > MAX_TABLE_BITS) {
+		throw std::runtime_error("memo tables have " + std::to_string(MIN_TABLE_BITS) + " to "
+				+ std::to_string(MAX_TABLE_BITS) + " bits");
+	}
+
+	// every odd n > 1 is stepped until it drops below itself, where the rest
+	// is known already
+	std::vector<uint32_t> entries(((size_t) 1) << (bits - 1));
+
+	for (size_t i = 1; i < entries.size(); i++) {
+		dbl_limb_t n = 2 * i + 1;
+		dbl_limb_t x = n;
+
+		size_t step_count_evn = 0;
+		size_t step_count_odd = 0;
+
+		while (x >= n) {
+			collatz_multistep::simple_single_step(x, step_count_odd);
+			step_count_evn++;
+		}
+
+		add_below(x, entries, step_count_evn, step_count_odd);
+
+		if (step_count_evn > 0xFFFF || step_count_odd > 0xFFFF) {
+			throw std::runtime_error("step counts of " + std::to_string((uint64_t) n) + " exceed 16 bits");
+		}
+
+		entries[i] = (uint32_t) (step_count_evn | (step_count_odd << 16));
+	}
+
+	std::ofstream out = table_file::create(path, TABLE_FILE_KIND);
+
+	table_file::header header = table_file::make_header(TABLE_FILE_MAGIC, TABLE_FILE_VERSION, bits, entries.size());
+
+	table_file::write_header(out, header);
+	out.seekp(header.data_offset);
+	out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(uint32_t));
+
+	table_file::finish(out, path);
+}
+
+void mapped_table::open(const string &path) {
+	file.open(path);
+
+	table_file::header header = table_file::read_header(file, TABLE_FILE_MAGIC, TABLE_FILE_VERSION, TABLE_FILE_KIND);
+
+	if (header.param < MIN_TABLE_BITS || header.param > MAX_TABLE_BITS
+			|| header.entry_count != ((uint64_t) 1) << (header.param - 1)) {
+		table_file::unsupported(file, TABLE_FILE_KIND, "bits=" + std::to_string(header.param));
+	}
+
+	table_file::ensure_data(file, header, header.entry_count, sizeof(uint32_t), TABLE_FILE_KIND);
+
+	entries = reinterpret_cast<const uint32_t*>(file.begin() + header.data_offset);
+	bits = header.param;
+}
+
+static mapped_table attached;
+
+void attach_table_file(const string &path) {
+	attached.open(path);
+}
+
+const mapped_table& attached_table() {
+	return attached;
+}
+
+static bool enabled = false;
+static size_t cache_bits = 0;
+
+void enable(size_t bits) {
+	if (bits > 40) {
+		throw std::runtime_error("the memo cache may have at most 2^40 entries");
+	}
+
+	enabled = true;
+	cache_bits = bits;
+}
+
+void disable() {
+	enabled = false;
+}
+
+bool is_enabled() {
+	return enabled;
+}
+
+// a direct mapped cache of the step counts of single limb values, 0 marks an
+// empty entry
+class tail_cache {
+public:
+	cache_stats stats;
+
+	bool find(uint64_t v, size_t &step_count_evn, size_t &step_count_odd) {
+		if (cache_bits == 0) {
+			return false;
+		}
+
+		// also after enable() with another size
+		if (entries.size() != ((size_t) 1) << cache_bits) {
+			entries.assign(((size_t) 1) << cache_bits, entry());
+		}
+
+		const entry &e = entries[index(v)];
+		if (e.value != v) {
+			stats.misses++;
+			return false;
+		}
+
+		stats.hits++;
+		step_count_evn += e.step_count_evn;
+		step_count_odd += e.step_count_odd;
+		return true;
+	}
+
+	void insert(uint64_t v, size_t step_count_evn, size_t step_count_odd) {
+		if (cache_bits == 0) {
+			return;
+		}
+
+		entry &e = entries[index(v)];
+		e.value = v;
+		e.step_count_evn = (uint32_t) step_count_evn;
+		e.step_count_odd = (uint32_t) step_count_odd;
+	}
+
+private:
+	struct entry {
+		uint64_t value = 0;
+		uint32_t step_count_evn = 0;
+		uint32_t step_count_odd = 0;
+	};
+
+	std::vector<entry> entries;
+
+	static inline size_t index(uint64_t v) {
+		return (size_t) ((v * 0x9E3779B97F4A7C15ull) >> (64 - cache_bits));
+	}
+};
+
+static thread_local tail_cache cache;
+
+bool finish(uint64_t v, size_t &step_count_evn, size_t &step_count_odd) {
+	const size_t W = collatz_multistep::COMBINED_IMPACT_TABLE_STEP_COUNT;
+	const dbl_limb_t ROUND_MIN = ((dbl_limb_t) 1) << (W + 1);
+	const dbl_limb_t MAX_VALUE = ((dbl_limb_t) 1) << 120;
+
+	size_t evn = __builtin_ctzll(v);
+	size_t odd = 0;
+	v >>= evn;
+
+	uint64_t limit = attached.limit();
+
+	if (v == 1) {
+		step_count_evn += evn;
+		return true;
+	}
+
+	if (v < limit) {
+		attached.add(v, evn, odd);
+	} else if (!cache.find(v, evn, odd)) {
+		size_t tail_evn = 0;
+		size_t tail_odd = 0;
+
+		dbl_limb_t x = v;
+
+		while (x != 1 && x >= limit) {
+			if (x >= MAX_VALUE) {
+				return false;
+			}
+
+			if (x >= ROUND_MIN) {
+				collatz_multistep::combined_impact_exactly<dbl_limb_t, W, W>(x, tail_evn, tail_odd);
+			} else {
+				collatz_multistep::simple_single_step(x, tail_odd);
+				tail_evn++;
+			}
+		}
+
+		if (x != 1) {
+			while ((x & 1) == 0) {
+				x >>= 1;
+				tail_evn++;
+			}
+
+			attached.add((uint64_t) x, tail_evn, tail_odd);
+		}
+
+		cache.insert(v, tail_evn, tail_odd);
+
+		evn += tail_evn;
+		odd += tail_odd;
+	}
+
+	step_count_evn += evn;
+	step_count_odd += odd;
+	return true;
+}
+
+cache_stats get_cache_stats() {
+	return cache.stats;
+}
+
+} /* namespace stopping_time_memo */
@@ -0,0 +1,95 @@
+#ifndef STOPPING_TIME_MEMO_H_
+#define STOPPING_TIME_MEMO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "mapped_file.h"
+#include "table_file.h"
+
+// memoized step counts until 1 of single limb values, which every check ends
+// with. the checkers hand the value to finish() as soon as it fits into a
+// limb, if enable() was called.
+//
+// the step counts of all odd values below 2^bits come from a table file,
+// written once by write_table_file() and mapped read-only by any number of
+// processes. bigger values are stepped until they drop below 2^bits and kept
+// in a direct mapped cache per thread with 2^cache_bits entries, which gets
+// hits when trajectories merge, e.g. of neighboring start values.
+//
+// the step counts are those of a check, so they are wrong for glides and
+// leave out the bit lengths of the values stepped over. the checkers do not
+// use finish() in glide mode and with track_max_bitlen.
+namespace stopping_time_memo {
+
+// layout: a table_file::header with bits as param, then at data_offset one
+// uint32_t per odd value n = 2 * i + 1 below 2^bits at index i, with the step
+// counts evn in the low and odd in the high 16 bits.
+const char TABLE_FILE_MAGIC[8] = { 'C', 'O', 'L', 'S', 'T', 'O', 'P', '\0' };
+const uint32_t TABLE_FILE_VERSION = 1;
+const char TABLE_FILE_KIND[] = "memo table";
+
+const size_t MIN_TABLE_BITS = 10;
+const size_t MAX_TABLE_BITS = 32;
+
+// builds the table in memory, which takes 2^(bits + 1) bytes, and writes it
+void write_table_file(const std::string &path, size_t bits);
+
+class mapped_table {
+public:
+	void open(const std::string &path);
+
+	bool is_open() const {
+		return file.is_open();
+	}
+
+	// values below this are covered, 0 without a table
+	uint64_t limit() const {
+		return is_open() ? ((uint64_t) 1) << bits : 0;
+	}
+
+	// adds the step counts of the odd value n < limit()
+	inline void add(uint64_t n, size_t &step_count_evn, size_t &step_count_odd) const {
+		uint32_t entry = entries[n >> 1];
+		step_count_evn += entry & 0xFFFF;
+		step_count_odd += entry >> 16;
+	}
+
+private:
+	mapped_file file;
+	const uint32_t *entries = nullptr;
+	size_t bits = 0;
+};
+
+// maps the table file at path for all threads of this process. not thread
+// safe, call it before starting any threads.
+void attach_table_file(const std::string &path);
+
+const mapped_table& attached_table();
+
+// enables finish() with the attached table, if any, and a cache of
+// 2^cache_bits entries per thread, 0 for none. not thread safe, call it
+// before starting any threads.
+void enable(size_t cache_bits);
+
+void disable();
+
+bool is_enabled();
+
+// adds the step counts of v >= 1 until 1 and returns true, or returns false
+// if the trajectory of v leaves 2^120 before it gets below the table, which
+// is then left to the checker.
+bool finish(uint64_t v, size_t &step_count_evn, size_t &step_count_odd);
+
+struct cache_stats {
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+};
+
+// of the calling thread
+cache_stats get_cache_stats();
+
+} /* namespace stopping_time_memo */
+
+#endif /* STOPPING_TIME_MEMO_H_ */
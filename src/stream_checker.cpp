@@ -0,0 +1,436 @@
+#include "stream_checker.h"
+
+#include <gmp.h>
+#include <gmpxx.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "checker_dispatch.h"
+#include "collatz_batch.h"
+#include "elapsed_time.h"
+#include "limb_file.h"
+#include "mpz_utils.h"
+#include "thread_pool.h"
+
+using std::string;
+
+namespace stream_checker {
+
+// raw input values, each [first, second) within data
+struct block {
+	std::vector<char> data;
+	std::vector<std::pair<size_t, size_t>> items;
+
+	void clear() {
+		data.clear();
+		items.clear();
+	}
+};
+
+class text_reader {
+public:
+	explicit text_reader(std::istream &in) :
+			in(in) {
+	}
+
+	// fills b with the complete lines of the next BLOCK_BYTES of input. a line
+	// longer than that is read to its end. returns false at the end of the input.
+	bool next(block &b) {
+		b.clear();
+		b.data.swap(rest);
+
+		size_t searched = 0;
+
+		while (true) {
+			size_t old_size = b.data.size();
+			b.data.resize(old_size + BLOCK_BYTES);
+			in.read(b.data.data() + old_size, BLOCK_BYTES);
+			b.data.resize(old_size + in.gcount());
+
+			if (!in || std::find(b.data.begin() + searched, b.data.end(), '\n') != b.data.end()) {
+				break;
+			}
+
+			searched = b.data.size();
+		}
+
+		// the part after the last newline belongs to the next block, unless the
+		// input has ended
+		size_t end = b.data.size();
+		if (in) {
+			end = std::find(b.data.rbegin(), b.data.rend(), '\n').base() - b.data.begin();
+			rest.assign(b.data.begin() + end, b.data.end());
+		}
+
+		for (size_t pos = 0; pos < end;) {
+			size_t line_end = std::find(b.data.begin() + pos, b.data.begin() + end, '\n') - b.data.begin();
+
+			size_t first = pos;
+			size_t last = line_end;
+			while (first < last && std::isspace((unsigned char) b.data[first])) {
+				first++;
+			}
+			while (last > first && std::isspace((unsigned char) b.data[last - 1])) {
+				last--;
+			}
+
+			if (first != last) {
+				b.items.emplace_back(first, last);
+			}
+
+			pos = line_end + 1;
+		}
+
+		return !b.items.empty() || !rest.empty() || in;
+	}
+
+private:
+	std::istream &in;
+	std::vector<char> rest;
+};
+
+class limb_reader {
+public:
+	explicit limb_reader(std::istream &in) :
+			in(in) {
+		char magic[sizeof(LIMB_STREAM_MAGIC)];
+		if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, LIMB_STREAM_MAGIC, sizeof(magic)) != 0) {
+			throw std::runtime_error("input is not a limb stream");
+		}
+	}
+
+	// fills b with the limbs of records until it holds BLOCK_BYTES. returns
+	// false at the end of the input. a corrupt record is reported by the call
+	// after the one returning the records before it.
+	bool next(block &b) {
+		b.clear();
+
+		if (!error.empty()) {
+			throw std::runtime_error(error);
+		}
+
+		uint64_t limb_count;
+		while (b.data.size() < BLOCK_BYTES && in.read(reinterpret_cast<char*>(&limb_count), sizeof(limb_count))) {
+			if (limb_count > MAX_RECORD_LIMBS) {
+				return fail(b, "limb stream record of " + std::to_string(limb_count) + " limbs");
+			}
+
+			size_t first = b.data.size();
+			size_t byte_count = limb_count * sizeof(mp_limb_t);
+
+			// grows with the data actually read, so that a corrupt limb count
+			// ends the input instead of allocating all of it
+			for (size_t done = 0; done < byte_count;) {
+				size_t piece = std::min(byte_count - done, BLOCK_BYTES);
+
+				b.data.resize(first + done + piece);
+				if (!in.read(b.data.data() + first + done, piece)) {
+					b.data.resize(first);
+					return fail(b, "limb stream ends within a record");
+				}
+
+				done += piece;
+			}
+
+			b.items.emplace_back(first, first + byte_count);
+		}
+
+		return !b.items.empty();
+	}
+
+private:
+	std::istream &in;
+	std::string error;
+
+	bool fail(block &b, const std::string &message) {
+		if (b.items.empty()) {
+			throw std::runtime_error(message);
+		}
+
+		error = message;
+		return true;
+	}
+};
+
+struct result {
+	std::string checker;
+	size_t bitlen = 0;
+
+	uint64_t step_count_evn = 0;
+	uint64_t step_count_odd = 0;
+	uint64_t iter_count = 0;
+
+	elapsed_time::elapsed_time_ns runtime = 0;
+
+	size_t max_bitlen = 0;
+};
+
+// a value of at most 19 decimal digits, which always fits into 64 bits
+static bool parse_small(const char *p, size_t n, uint64_t &v) {
+	if (n > 19) {
+		return false;
+	}
+
+	return std::from_chars(p, p + n, v).ptr == p + n;
+}
+
+static void parse(const char *p, size_t n, uint64_t index, mpz_class &v) {
+	int base = 10;
+	if (n > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+		base = 16;
+		p += 2;
+		n -= 2;
+	}
+
+	if (mpz_set_str(v.get_mpz_t(), string(p, n).c_str(), base) != 0) {
+		throw std::runtime_error(
+				"invalid value at index " + std::to_string(index) + ": " + string(p, std::min(n, (size_t) 40)));
+	}
+}
+
+static void check_single(mpz_srcptr v, const options &opts, result &r) {
+	r.bitlen = mpz_sizeinbase(v, 2);
+
+	checker_dispatch::result dispatched;
+
+	elapsed_time::elapsed_time_ns t = elapsed_time::steady_time();
+	checker_dispatch::check(v, dispatched, opts.max_bitlen);
+	r.runtime = elapsed_time::steady_time() - t;
+
+	r.checker = dispatched.checkers;
+	r.step_count_evn = dispatched.step_count_evn;
+	r.step_count_odd = dispatched.step_count_odd;
+	r.iter_count = dispatched.iter_count;
+	r.max_bitlen = std::max(dispatched.max_bitlen, r.bitlen);
+}
+
+static void append(string &s, uint64_t v) {
+	char buf[24];
+	s.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+}
+
+static void format(uint64_t index, const result &r, const options &opts, string &out) {
+	if (opts.output == output_format::csv) {
+		append(out, index);
+		out += ',';
+		append(out, r.bitlen);
+		out += ',';
+		out += r.checker;
+		out += ',';
+		append(out, r.step_count_evn);
+		out += ',';
+		append(out, r.step_count_odd);
+		out += ',';
+		append(out, r.iter_count);
+		out += ',';
+		append(out, r.runtime);
+
+		if (opts.max_bitlen) {
+			out += ',';
+			append(out, r.max_bitlen);
+		}
+
+		out += '\n';
+		return;
+	}
+
+	out += "{\"index\":";
+	append(out, index);
+	out += ",\"bitlen\":";
+	append(out, r.bitlen);
+	out += ",\"checker\":\"";
+	out += r.checker;
+	out += "\",\"step_count_evn\":";
+	append(out, r.step_count_evn);
+	out += ",\"step_count_odd\":";
+	append(out, r.step_count_odd);
+	out += ",\"iter_count\":";
+	append(out, r.iter_count);
+	out += ",\"runtime_ns\":";
+	append(out, r.runtime);
+
+	if (opts.max_bitlen) {
+		out += ",\"max_bitlen\":";
+		append(out, r.max_bitlen);
+	}
+
+	out += "}\n";
+}
+
+// checks the values [first, last) of b, whose first value has first_index,
+// and appends their records to out. returns the error of the first bad value,
+// with the records of the values before it in out, or an empty string.
+static string process(const block &b, size_t first, size_t last, uint64_t first_index, const options &opts,
+		string &out) {
+	std::vector<result> results(last - first);
+
+	// values below 2^64 are collected for collatz_batch
+	std::vector<uint64_t> batch_values;
+	std::vector<size_t> batch_positions;
+
+	mpz_class v;
+
+	string error;
+
+	for (size_t i = first; i < last; i++) {
+		const char *p = b.data.data() + b.items[i].first;
+		size_t n = b.items[i].second - b.items[i].first;
+
+		uint64_t small = 0;
+		bool is_small = false;
+
+		try {
+			if (opts.input == input_format::text) {
+				is_small = parse_small(p, n, small);
+
+				if (!is_small) {
+					parse(p, n, first_index + i, v);
+				}
+			} else {
+				size_t limb_count = n / sizeof(mp_limb_t);
+				std::memcpy(mpz_limbs_write(v.get_mpz_t(), std::max(limb_count, (size_t) 1)), p, n);
+				mpz_limbs_finish(v.get_mpz_t(), limb_count);
+			}
+
+			if (!is_small && mpz_sgn(v.get_mpz_t()) >= 0 && mpz_fits_ulong_p(v.get_mpz_t())) {
+				small = v.get_ui();
+				is_small = true;
+			}
+
+			if (is_small && small != 0 && !opts.max_bitlen) {
+				batch_values.push_back(small);
+				batch_positions.push_back(i - first);
+				continue;
+			}
+
+			if (is_small) {
+				mpz_set_ui(v.get_mpz_t(), small);
+			}
+
+			if (v < 1) {
+				throw std::runtime_error("value at index " + std::to_string(first_index + i) + " is below 1");
+			}
+
+			check_single(v.get_mpz_t(), opts, results[i - first]);
+		} catch (const std::exception &e) {
+			error = e.what();
+			last = i;
+			break;
+		}
+	}
+
+	if (!batch_values.empty()) {
+		std::vector<collatz_batch::step_counts> counts(batch_values.size());
+
+		elapsed_time::elapsed_time_ns t = elapsed_time::steady_time();
+		collatz_batch::check(batch_values.data(), batch_values.size(), counts.data());
+		t = elapsed_time::steady_time() - t;
+
+		// the batch checks its values together, so each gets an equal share
+		elapsed_time::elapsed_time_ns runtime = t / batch_values.size();
+
+		for (size_t j = 0; j < batch_values.size(); j++) {
+			result &r = results[batch_positions[j]];
+			r.checker = "batch";
+			r.bitlen = LIMB_BITSIZE - __builtin_clzll(batch_values[j]);
+			r.step_count_evn = counts[j].evn;
+			r.step_count_odd = counts[j].odd;
+			r.runtime = runtime;
+		}
+	}
+
+	for (size_t i = first; i < last; i++) {
+		format(first_index + i, results[i - first], opts, out);
+	}
+
+	return error;
+}
+
+template<typename READER>
+static uint64_t run_with(READER &reader, std::ostream &out, const options &opts) {
+	if (opts.thread_count == 0) {
+		throw std::runtime_error("the thread count has to be at least 1");
+	}
+
+	thread_pool pool(opts.thread_count);
+
+	// enough tasks to balance big values, but not so many that the batches
+	// get small
+	const size_t MIN_TASK_SIZE = 4096;
+	const size_t MAX_TASK_COUNT = opts.thread_count * 8;
+
+	std::vector<string> texts(MAX_TASK_COUNT);
+	std::vector<string> errors(MAX_TASK_COUNT);
+
+	block current;
+	block next;
+
+	bool more = reader.next(current);
+
+	uint64_t index = 0;
+
+	while (more) {
+		// the next block is read while this one is checked
+		std::future<bool> reading = std::async(std::launch::async, [&] {
+			return reader.next(next);
+		});
+
+		size_t n = current.items.size();
+		size_t task_count = std::max(std::min(MAX_TASK_COUNT, n / MIN_TASK_SIZE), (size_t) 1);
+
+		pool.run(task_count, [&](size_t t) {
+			texts[t].clear();
+			errors[t].clear();
+
+			try {
+				errors[t] = process(current, n * t / task_count, n * (t + 1) / task_count, index, opts, texts[t]);
+			} catch (const std::exception &e) {
+				errors[t] = e.what();
+			}
+		});
+
+		// the records up to the first bad value are written before its error
+		for (size_t t = 0; t < task_count; t++) {
+			out.write(texts[t].data(), texts[t].size());
+
+			if (!errors[t].empty()) {
+				out.flush();
+				reading.wait();
+				throw std::runtime_error(errors[t]);
+			}
+		}
+
+		more = reading.get();
+
+		index += n;
+		current.data.swap(next.data);
+		current.items.swap(next.items);
+	}
+
+	out.flush();
+
+	return index;
+}
+
+uint64_t run(std::istream &in, std::ostream &out, const options &opts) {
+	if (opts.output == output_format::csv) {
+		out << "index,bitlen,checker,step_count_evn,step_count_odd,iter_count,runtime_ns"
+				<< (opts.max_bitlen ? ",max_bitlen" : "") << "\n";
+	}
+
+	if (opts.input == input_format::text) {
+		text_reader reader(in);
+		return run_with(reader, out, opts);
+	}
+
+	limb_reader reader(in);
+	return run_with(reader, out, opts);
+}
+
+} /* namespace stream_checker */
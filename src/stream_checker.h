@@ -0,0 +1,64 @@
+#ifndef STREAM_CHECKER_H_
+#define STREAM_CHECKER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// checks a stream of start values and writes one record per value, in the
+// order of the input.
+//
+// the input is read in blocks of about BLOCK_BYTES, so that only a few blocks
+// are in memory at a time. each block is split among the threads, which parse
+// their values, check them and format their records into their own buffer.
+// the buffers are written in one piece per block.
+//
+// values below 2^64 are checked by collatz_batch. bigger ones are checked by
+// checker_dispatch::check() with the selected profile.
+namespace stream_checker {
+
+enum class input_format {
+	// one decimal or 0x hexadecimal value per line, empty lines are skipped
+	text,
+
+	// a limb stream, see LIMB_STREAM_MAGIC
+	limbs
+};
+
+enum class output_format {
+	// a header line and then index,bitlen,checker,step_count_evn,
+	// step_count_odd,iter_count,runtime_ns[,max_bitlen]
+	csv,
+
+	// one json object per value with the same fields
+	jsonl
+};
+
+const size_t BLOCK_BYTES = ((size_t) 8) << 20;
+
+// limb stream records with more limbs are rejected as corrupt
+const uint64_t MAX_RECORD_LIMBS = ((uint64_t) 1) << 34;
+
+struct options {
+	input_format input = input_format::text;
+	output_format output = output_format::csv;
+
+	size_t thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+	// track the largest bit length of each value, sampled after every
+	// iteration. the batch kernels cannot do this, so all values are checked
+	// one by one.
+	bool max_bitlen = false;
+};
+
+// returns the number of values checked. throws at the first bad value, after
+// writing the records of all values before it.
+uint64_t run(std::istream &in, std::ostream &out, const options &opts);
+
+} /* namespace stream_checker */
+
+#endif /* STREAM_CHECKER_H_ */
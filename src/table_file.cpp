@@ -0,0 +1,87 @@
+#include "table_file.h"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+using std::string;
+
+namespace table_file {
+
+header make_header(const char (&magic)[8], uint32_t version, uint32_t param, uint64_t entry_count,
+		uint64_t extra_bytes) {
+	header h;
+	std::memcpy(h.magic, magic, sizeof(h.magic));
+	h.version = version;
+	h.param = param;
+	h.entry_count = entry_count;
+	h.data_offset = align(sizeof(h) + extra_bytes);
+
+	return h;
+}
+
+std::ofstream create(const string &path, const string &kind) {
+	if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) {
+		throw std::runtime_error(kind + " files are only supported on little-endian hosts");
+	}
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		throw std::runtime_error("cannot create " + path);
+	}
+
+	return out;
+}
+
+void write_header(std::ofstream &out, const header &h) {
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+}
+
+void finish(std::ofstream &out, const string &path) {
+	out.close();
+	if (!out) {
+		throw std::runtime_error("error writing " + path);
+	}
+}
+
+header read_header(const mapped_file &file, const char (&magic)[8], uint32_t version, const string &kind) {
+	header h;
+	if (file.size() < sizeof(h)) {
+		throw std::runtime_error("truncated " + kind + " file " + file.get_path());
+	}
+
+	std::memcpy(&h, file.begin(), sizeof(h));
+
+	if (std::memcmp(h.magic, magic, sizeof(h.magic)) != 0) {
+		throw std::runtime_error("not a " + kind + " file: " + file.get_path());
+	}
+
+	if (h.version != version) {
+		unsupported(file, kind, "version=" + std::to_string(h.version));
+	}
+
+	if (h.data_offset < sizeof(h) || h.data_offset % sizeof(uint64_t) != 0) {
+		unsupported(file, kind, "data_offset=" + std::to_string(h.data_offset));
+	}
+
+	if (file.size() < h.data_offset) {
+		throw std::runtime_error("truncated " + kind + " file " + file.get_path());
+	}
+
+	return h;
+}
+
+void unsupported(const mapped_file &file, const string &kind, const string &detail) {
+	std::ostringstream os;
+	os << "unsupported " << kind << " file " << file.get_path() << " (" << detail << ")";
+	throw std::runtime_error(os.str());
+}
+
+void ensure_data(const mapped_file &file, const header &h, uint64_t count, size_t element_size, const string &kind) {
+	if ((file.size() - h.data_offset) / element_size < count) {
+		throw std::runtime_error("truncated " + kind + " file " + file.get_path());
+	}
+}
+
+} /* namespace table_file */
@@ -0,0 +1,65 @@
+#ifndef TABLE_FILE_H_
+#define TABLE_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <fstream>
+#include <string>
+
+#include "mapped_file.h"
+
+// the common header of the binary files that are written once and mapped
+// read-only: power of 3 tables, limb files and memo tables. each format has
+// its own magic and version and its own meaning of param and entry_count.
+// the data starts cache line aligned at data_offset.
+//
+// the files hold raw little-endian words, so they are only written and read
+// on little-endian hosts.
+namespace table_file {
+
+struct header {
+	char magic[8];
+	uint32_t version;
+
+	// e.g. the limb size of the data
+	uint32_t param;
+
+	uint64_t entry_count;
+	uint64_t data_offset;
+};
+
+const uint64_t DATA_ALIGNMENT = 64;
+
+inline uint64_t align(uint64_t offset) {
+	return (offset + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1);
+}
+
+// with the data right after the header, or after extra bytes behind it
+header make_header(const char (&magic)[8], uint32_t version, uint32_t param, uint64_t entry_count,
+		uint64_t extra_bytes = 0);
+
+// opens path for writing a file of the kind, e.g. "limb"
+std::ofstream create(const std::string &path, const std::string &kind);
+
+// writes h at the start of out
+void write_header(std::ofstream &out, const header &h);
+
+// closes out and throws if any write failed
+void finish(std::ofstream &out, const std::string &path);
+
+// the header of a mapped file of the kind, whose magic and version were
+// checked, with its data_offset behind the header and within the file
+header read_header(const mapped_file &file, const char (&magic)[8], uint32_t version, const std::string &kind);
+
+// throws that the file of the kind has an unsupported detail, e.g.
+// "limb_size=4"
+[[noreturn]] void unsupported(const mapped_file &file, const std::string &kind, const std::string &detail);
+
+// throws unless the file holds count elements of element_size bytes at the
+// data_offset of h
+void ensure_data(const mapped_file &file, const header &h, uint64_t count, size_t element_size,
+		const std::string &kind);
+
+} /* namespace table_file */
+
+#endif /* TABLE_FILE_H_ */
@@ -0,0 +1,91 @@
+#include "thread_pool.h"
+
+thread_pool::thread_pool(size_t thread_count) :
+		next_task(0) {
+	for (size_t i = 1; i < thread_count; i++) {
+		workers.emplace_back([this]() {
+			worker_loop();
+		});
+	}
+}
+
+thread_pool::~thread_pool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	job_started.notify_all();
+
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
+
+void thread_pool::run(size_t task_count, const std::function<void(size_t)> &task) {
+	std::lock_guard<std::mutex> run_lock(run_mutex);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &task;
+		job_size = task_count;
+		next_task = 0;
+		busy_count = workers.size();
+		generation++;
+	}
+
+	job_started.notify_all();
+
+	work(task, task_count);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	job_finished.wait(lock, [this]() {
+		return busy_count == 0;
+	});
+
+	job = nullptr;
+}
+
+void thread_pool::work(const std::function<void(size_t)> &task, size_t task_count) {
+	for (;;) {
+		size_t i = next_task++;
+		if (i >= task_count) {
+			return;
+		}
+
+		task(i);
+	}
+}
+
+void thread_pool::worker_loop() {
+	uint64_t seen_generation = 0;
+
+	for (;;) {
+		const std::function<void(size_t)> *task;
+		size_t task_count;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			job_started.wait(lock, [&]() {
+				return stopping || generation != seen_generation;
+			});
+
+			if (stopping) {
+				return;
+			}
+
+			seen_generation = generation;
+			task = job;
+			task_count = job_size;
+		}
+
+		work(*task, task_count);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy_count--;
+		}
+
+		job_finished.notify_one();
+	}
+}
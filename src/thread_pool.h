@@ -0,0 +1,55 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a fixed set of threads, which run the tasks of one job at a time. the
+// thread calling run() works on the job as well, so a pool of size n has n-1
+// own threads.
+class thread_pool {
+public:
+	explicit thread_pool(size_t thread_count);
+
+	~thread_pool();
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	size_t size() const {
+		return workers.size() + 1;
+	}
+
+	// calls task(i) for all i in [0, task_count) and returns when all calls
+	// have returned. concurrent calls of run() are serialized. tasks may not
+	// call run() on the same pool.
+	void run(size_t task_count, const std::function<void(size_t)> &task);
+
+private:
+	std::vector<std::thread> workers;
+
+	std::mutex run_mutex;
+
+	std::mutex mutex;
+	std::condition_variable job_started;
+	std::condition_variable job_finished;
+
+	const std::function<void(size_t)> *job = nullptr;
+	size_t job_size = 0;
+	std::atomic<size_t> next_task;
+	size_t busy_count = 0;
+	uint64_t generation = 0;
+	bool stopping = false;
+
+	void worker_loop();
+
+	void work(const std::function<void(size_t)> &task, size_t task_count);
+};
+
+#endif /* THREAD_POOL_H_ */
@@ -0,0 +1,65 @@
+#ifndef WORK_STEALING_QUEUE_H_
+#define WORK_STEALING_QUEUE_H_
+
+#include <stddef.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// task indices distributed over one deque per worker. a worker takes tasks
+// from the front of its own deque and, when that is empty, steals from the
+// back of the other workers' deques.
+class work_stealing_queue {
+public:
+	explicit work_stealing_queue(size_t worker_count) {
+		for (size_t i = 0; i < worker_count; i++) {
+			deques.emplace_back(new locked_deque());
+		}
+	}
+
+	size_t worker_count() const {
+		return deques.size();
+	}
+
+	void push(size_t worker, size_t task) {
+		locked_deque &d = *deques[worker];
+		std::lock_guard<std::mutex> lock(d.mutex);
+		d.tasks.push_back(task);
+	}
+
+	// returns false when all deques are empty
+	bool pop(size_t worker, size_t &task) {
+		{
+			locked_deque &d = *deques[worker];
+			std::lock_guard<std::mutex> lock(d.mutex);
+			if (!d.tasks.empty()) {
+				task = d.tasks.front();
+				d.tasks.pop_front();
+				return true;
+			}
+		}
+
+		for (size_t i = 1; i < deques.size(); i++) {
+			locked_deque &d = *deques[(worker + i) % deques.size()];
+			std::lock_guard<std::mutex> lock(d.mutex);
+			if (!d.tasks.empty()) {
+				task = d.tasks.back();
+				d.tasks.pop_back();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+private:
+	struct locked_deque {
+		std::mutex mutex;
+		std::deque<size_t> tasks;
+	};
+
+	std::vector<std::unique_ptr<locked_deque>> deques;
+};
+
+#endif /* WORK_STEALING_QUEUE_H_ */